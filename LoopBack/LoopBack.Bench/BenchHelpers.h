@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace LoopBackBench
+{
+    // Runs body the given number of times after one warm-up run and returns the median
+    // duration of a run in milliseconds.
+    template <typename TBody>
+    const double MeasureMedian(const uint32_t iterations, TBody&& body)
+    {
+        body();
+        std::vector<double> samples;
+        for (uint32_t i = 0; i < std::max<uint32_t>(iterations, 1); i++)
+        {
+            const auto started = std::chrono::steady_clock::now();
+            body();
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    // Parses "--name value" pairs into the fields registered with Add.
+    struct OptionParser
+    {
+        void Add(const std::string& name, uint32_t& value) { numbers.push_back({ name, &value }); }
+
+        const bool Parse(const int argc, char** argv) const
+        {
+            for (int i = 1; i < argc; i++)
+            {
+                const std::string name = argv[i];
+                const auto number = std::find_if(numbers.begin(), numbers.end(), [&](const auto& item) { return item.first == name; });
+                if (number == numbers.end() || i + 1 >= argc) { return false; }
+                *number->second = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+            }
+            return true;
+        }
+
+    private:
+        std::vector<std::pair<std::string, uint32_t*>> numbers;
+    };
+}
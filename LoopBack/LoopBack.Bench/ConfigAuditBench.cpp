@@ -0,0 +1,112 @@
+#include "BenchHelpers.h"
+#include "ConfigListAudit.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::AuditSidList;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Entries = 50000;
+        // Config entries per hundred whose container is gone, and that repeat an earlier entry.
+        uint32_t OrphanedPercent = 30;
+        uint32_t DuplicatePercent = 2;
+        uint32_t Iterations = 5;
+        uint32_t Seed = 1;
+    };
+
+    wstring GetSid(const uint32_t key)
+    {
+        return L"S-1-15-2-" + to_wstring(key) + L"-1910091885-1573563583-1104941280-2418270861-3411158377-2822700936";
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: ConfigAuditBench [options]\n"
+            "  --entries N          SIDs in the config list (50000)\n"
+            "  --orphaned N         percent of entries without a live container (30)\n"
+            "  --duplicates N       percent of entries that repeat an earlier one (2)\n"
+            "  --iterations N       measured runs per size (5)\n"
+            "  --seed N             seed of the generated list (1)\n");
+    }
+}
+
+// Joins an exemption config list against the live containers the way AuditExemptions does,
+// with a hash set standing in for the SID index of the snapshot. The join runs at a tenth of
+// the size and at full size to compare the cost per entry, which only grows as the hash sets
+// outgrow the caches. The counts it reports have to match the ones the list was generated with.
+int main(const int argc, char** argv)
+{
+    Options options;
+    OptionParser parser;
+    parser.Add("--entries", options.Entries);
+    parser.Add("--orphaned", options.OrphanedPercent);
+    parser.Add("--duplicates", options.DuplicatePercent);
+    parser.Add("--iterations", options.Iterations);
+    parser.Add("--seed", options.Seed);
+    if (!parser.Parse(argc, argv) || options.Entries < 10 || options.OrphanedPercent + options.DuplicatePercent > 100)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    printf("ConfigAuditBench: %u%% orphaned, %u%% duplicates\n\n", options.OrphanedPercent, options.DuplicatePercent);
+    printf("%-10s %10s %10s %10s %10s %12s\n", "entries", "kept", "orphaned", "duplicates", "ms", "ns/entry");
+
+    bool isCorrect = true;
+    for (const uint32_t entries : { options.Entries / 10, options.Entries })
+    {
+        mt19937 random(options.Seed);
+        vector<wstring> configList;
+        vector<uint32_t> liveIndexes;
+        size_t expectedOrphaned = 0;
+        size_t expectedDuplicates = 0;
+        for (uint32_t i = 0; i < entries; i++)
+        {
+            const uint32_t roll = random() % 100;
+            if (roll < options.DuplicatePercent && !configList.empty())
+            {
+                configList.push_back(configList[random() % configList.size()]);
+                expectedDuplicates++;
+                continue;
+            }
+            if (roll < options.DuplicatePercent + options.OrphanedPercent) { expectedOrphaned++; }
+            else { liveIndexes.push_back(static_cast<uint32_t>(configList.size())); }
+            configList.push_back(GetSid(i));
+        }
+
+        //Views share the strings the way the server's hstrings share their buffers.
+        unordered_set<wstring_view> liveSet;
+        for (const uint32_t index : liveIndexes) { liveSet.insert(configList[index]); }
+        const vector<wstring_view> configViews(configList.begin(), configList.end());
+
+        vector<wstring_view> keptList;
+        vector<wstring_view> orphanedList;
+        vector<wstring_view> duplicateList;
+        const auto isLive = [&](const wstring_view sid) { return liveSet.contains(sid); };
+        const double elapsed = MeasureMedian(options.Iterations, [&]()
+            {
+                keptList.clear();
+                orphanedList.clear();
+                duplicateList.clear();
+                AuditSidList<wstring_view>(configViews, configViews.size(), isLive, &keptList, &orphanedList, &duplicateList);
+            });
+
+        isCorrect &= orphanedList.size() == expectedOrphaned && duplicateList.size() == expectedDuplicates
+            && keptList.size() + expectedOrphaned + expectedDuplicates == entries;
+        printf("%-10u %10zu %10zu %10zu %10.3f %12.1f\n", entries, keptList.size(), orphanedList.size(), duplicateList.size(),
+            elapsed, elapsed * 1e6 / entries);
+    }
+
+    printf("\nresults: %s\n", isCorrect ? "OK" : "FAILED");
+    return isCorrect ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include "BenchHelpers.h"
+#include "ContentHash.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::ContentHash;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Containers = 10000;
+        uint32_t Iterations = 5;
+        uint32_t Seed = 1;
+    };
+
+    // The fields of INET_FIREWALL_APP_CONTAINER a snapshot converts and hashes.
+    struct Container
+    {
+        wstring AppContainerSid;
+        wstring UserSid;
+        wstring DisplayName;
+        wstring Description;
+        wstring AppContainerName;
+        wstring PackageFullName;
+        wstring WorkingDirectory;
+        vector<wstring> Capabilities;
+        vector<wstring> Binaries;
+    };
+
+    const vector<Container> GetContainers(const Options& options)
+    {
+        mt19937 random(options.Seed);
+        vector<Container> containers;
+        for (uint32_t i = 0; i < options.Containers; i++)
+        {
+            const wstring name = L"Publisher" + to_wstring(i / 10) + L".App" + to_wstring(i % 10);
+            const wstring packageFullName = name + L"_1.0." + to_wstring(random() % 100) + L".0_x64__8wekyb3d8bbwe";
+            Container container;
+            container.AppContainerSid = L"S-1-15-2-" + to_wstring(random()) + L"-" + to_wstring(random()) + L"-" + to_wstring(random()) + L"-" + to_wstring(random());
+            container.UserSid = L"S-1-5-21-3623811015-3361044348-30300820-" + to_wstring(1001 + i % 4);
+            container.DisplayName = L"App " + to_wstring(i);
+            container.Description = L"App " + to_wstring(i) + L" of publisher " + to_wstring(i / 10);
+            container.AppContainerName = name + L"_8wekyb3d8bbwe";
+            container.PackageFullName = packageFullName;
+            container.WorkingDirectory = L"C:\\Program Files\\WindowsApps\\" + packageFullName;
+            for (uint32_t j = random() % 6; j > 0; j--)
+            {
+                container.Capabilities.push_back(L"S-1-15-3-" + to_wstring(random() % 16));
+            }
+            container.Binaries.push_back(container.WorkingDirectory + L"\\" + name + L".exe");
+            containers.push_back(move(container));
+        }
+        return containers;
+    }
+
+    // What AppContainerSnapshot::Hash computes for a container.
+    const uint64_t Hash(const Container& container)
+    {
+        uint64_t sidHash = ContentHash::OffsetBasis;
+        ContentHash::AddString(sidHash, container.AppContainerSid);
+        ContentHash::AddString(sidHash, container.UserSid);
+        sidHash = ContentHash::Mix(sidHash);
+
+        uint64_t hash = sidHash;
+        for (const wstring* value : { &container.DisplayName, &container.Description, &container.AppContainerName, &container.PackageFullName, &container.WorkingDirectory })
+        {
+            ContentHash::AddString(hash, *value);
+        }
+        for (const vector<wstring>* values : { &container.Capabilities, &container.Binaries })
+        {
+            for (const wstring& value : *values)
+            {
+                ContentHash::AddString(hash, value);
+            }
+            ContentHash::EndList(hash);
+        }
+        return ContentHash::Mix(hash);
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: ContentHashBench [options]\n"
+            "  --containers N       containers in the snapshot (10000)\n"
+            "  --iterations N       measured runs per pass (5)\n"
+            "  --seed N             seed of the generated containers (1)\n");
+    }
+}
+
+// Cost of the snapshot ETag against the string copies a snapshot build makes anyway. The copy
+// pass stands in for converting the enumeration records into AppContainer objects, which
+// costs more on Windows, so the overhead shown is an upper bound. The sum has to come out
+// the same in reverse order, since snapshots are compared across enumerations.
+int main(const int argc, char** argv)
+{
+    Options options;
+    OptionParser parser;
+    parser.Add("--containers", options.Containers);
+    parser.Add("--iterations", options.Iterations);
+    parser.Add("--seed", options.Seed);
+    if (!parser.Parse(argc, argv) || options.Containers == 0)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    const vector<Container> containers = GetContainers(options);
+    size_t bytes = 0;
+    for (const Container& container : containers)
+    {
+        for (const wstring* value : { &container.AppContainerSid, &container.UserSid, &container.DisplayName, &container.Description, &container.AppContainerName, &container.PackageFullName, &container.WorkingDirectory })
+        {
+            bytes += value->size() * sizeof(wchar_t);
+        }
+        for (const vector<wstring>* values : { &container.Capabilities, &container.Binaries })
+        {
+            for (const wstring& value : *values) { bytes += value.size() * sizeof(wchar_t); }
+        }
+    }
+
+    vector<Container> copies;
+    const double copy = MeasureMedian(options.Iterations, [&]()
+        {
+            copies.clear();
+            copies.reserve(containers.size());
+            for (const Container& container : containers) { copies.push_back(container); }
+        });
+
+    uint64_t contentHash = 0;
+    const double hash = MeasureMedian(options.Iterations, [&]()
+        {
+            contentHash = 0;
+            for (const Container& container : containers) { contentHash += Hash(container); }
+        });
+
+    uint64_t reversedHash = 0;
+    for (auto container = containers.rbegin(); container != containers.rend(); ++container)
+    {
+        reversedHash += Hash(*container);
+    }
+
+    printf("ContentHashBench: %u containers, %.2f MB of strings\n\n", options.Containers, bytes / (1024.0 * 1024.0));
+    printf("%-22s %10s %14s\n", "pass", "ms", "ns/container");
+    printf("%-22s %10.3f %14.1f\n", "copy fields", copy, copy * 1e6 / options.Containers);
+    printf("%-22s %10.3f %14.1f\n", "content hash", hash, hash * 1e6 / options.Containers);
+    printf("\nhash overhead on the copy pass: %.1f%%\n", copy > 0 ? hash * 100 / copy : 0.0);
+
+    const bool isCorrect = contentHash == reversedHash;
+    printf("results: ETag %016llx, %s in reverse order: %s\n", static_cast<unsigned long long>(contentHash),
+        isCorrect ? "same" : "different", isCorrect ? "OK" : "FAILED");
+    return isCorrect ? 0 : 1;
+}
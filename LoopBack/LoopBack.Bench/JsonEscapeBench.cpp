@@ -0,0 +1,136 @@
+#include "BenchHelpers.h"
+#include "JsonEscape.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::EscapeJson;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Containers = 10000;
+        uint32_t Iterations = 5;
+        uint32_t Seed = 1;
+    };
+
+    // One byte at a time, the baseline the vectorized scan is measured against.
+    void EscapeBytes(const string_view value, string& output)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        for (const char item : value)
+        {
+            const unsigned char c = static_cast<unsigned char>(item);
+            switch (c)
+            {
+            case '"': output.append("\\\""); break;
+            case '\\': output.append("\\\\"); break;
+            case '\b': output.append("\\b"); break;
+            case '\f': output.append("\\f"); break;
+            case '\n': output.append("\\n"); break;
+            case '\r': output.append("\\r"); break;
+            case '\t': output.append("\\t"); break;
+            default:
+                if (c < 0x20)
+                {
+                    output.append("\\u00");
+                    output.push_back(hex[c >> 4]);
+                    output.push_back(hex[c & 0xF]);
+                }
+                else
+                {
+                    output.push_back(item);
+                }
+                break;
+            }
+        }
+    }
+
+    // The string fields of one exported container: names, a description, paths and SIDs,
+    // with the backslashes of the paths as the only characters that need escaping.
+    const vector<string> GetFields(const Options& options)
+    {
+        mt19937 random(options.Seed);
+        vector<string> fields;
+        for (uint32_t i = 0; i < options.Containers; i++)
+        {
+            const string name = "Publisher" + to_string(i / 10) + ".App" + to_string(random() % 100);
+            fields.push_back(name);
+            fields.push_back("App " + to_string(i) + " of a publisher, with a description that runs for a while");
+            fields.push_back(name + "_1.0." + to_string(i) + ".0_x64__8wekyb3d8bbwe");
+            fields.push_back("C:\\Program Files\\WindowsApps\\" + name + "_1.0." + to_string(i) + ".0_x64__8wekyb3d8bbwe");
+            fields.push_back("S-1-15-2-" + to_string(random()) + "-" + to_string(random()) + "-" + to_string(random()) + "-" + to_string(random()));
+            fields.push_back("C:\\Program Files\\WindowsApps\\" + name + "\\" + name + ".exe");
+        }
+        return fields;
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: JsonEscapeBench [options]\n"
+            "  --containers N       containers whose fields are escaped (10000)\n"
+            "  --iterations N       measured runs per escaper (5)\n"
+            "  --seed N             seed of the generated fields (1)\n");
+    }
+}
+
+// Throughput of the JSON string escaping AppContainerExporter runs on every field, against a
+// byte at a time escaper. Output goes to one reused string, the way the exporter reuses its
+// buffer, so the numbers are the escaping and not the allocations.
+int main(const int argc, char** argv)
+{
+    Options options;
+    OptionParser parser;
+    parser.Add("--containers", options.Containers);
+    parser.Add("--iterations", options.Iterations);
+    parser.Add("--seed", options.Seed);
+    if (!parser.Parse(argc, argv) || options.Containers == 0)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    const vector<string> fields = GetFields(options);
+    size_t bytes = 0;
+    for (const string& field : fields) { bytes += field.size(); }
+
+    string escaped;
+    string expected;
+    size_t mismatches = 0;
+    for (const string& field : fields)
+    {
+        escaped.clear();
+        expected.clear();
+        EscapeJson(field, escaped);
+        EscapeBytes(field, expected);
+        mismatches += escaped != expected ? 1 : 0;
+    }
+
+    const auto run = [&](void(*escape)(string_view, string&))
+        {
+            return MeasureMedian(options.Iterations, [&]()
+                {
+                    for (const string& field : fields)
+                    {
+                        escaped.clear();
+                        escape(field, escaped);
+                    }
+                });
+        };
+    const double vectorized = run(EscapeJson);
+    const double scalar = run(EscapeBytes);
+
+    const double megabytes = bytes / (1024.0 * 1024.0);
+    printf("JsonEscapeBench: %u containers, %zu fields, %.2f MB\n\n", options.Containers, fields.size(), megabytes);
+    printf("%-22s %10s %10s\n", "escaper", "ms", "MB/s");
+    printf("%-22s %10.3f %10.1f\n", "EscapeJson", vectorized, megabytes / (vectorized / 1000));
+    printf("%-22s %10.3f %10.1f\n", "byte at a time", scalar, megabytes / (scalar / 1000));
+
+    printf("\nresults: %zu mismatches against the byte at a time escaper: %s\n", mismatches, mismatches == 0 ? "OK" : "FAILED");
+    return mismatches == 0 ? 0 : 1;
+}
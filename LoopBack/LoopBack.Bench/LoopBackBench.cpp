@@ -0,0 +1,292 @@
+#include "RequestScheduler.h"
+#include "SimulatedBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::RequestScheduler;
+
+namespace
+{
+    // Ranks in the order of the RequestClass enum of the server.
+    enum class RequestClass : size_t
+    {
+        InteractiveRead,
+        InteractiveWrite,
+        BackgroundRefresh,
+        Bulk
+    };
+
+    constexpr const char* ClassNames[RequestScheduler::ClassCount] = { "InteractiveRead", "InteractiveWrite", "BackgroundRefresh", "Bulk" };
+
+    // LoopUtil::BulkChunkSize.
+    constexpr size_t BulkChunkSize = 64;
+
+    struct Options
+    {
+        uint32_t Clients = 16;
+        uint32_t Operations = 500;
+        uint32_t Containers = 2000;
+        uint32_t SidsPerClient = 512;
+        uint32_t BulkSize = 100;
+        double LatencyScale = 1.0;
+        bool IsScheduled = true;
+        uint32_t Seed = 1;
+    };
+
+    // Latencies in microseconds of every operation of one client, by class.
+    using Samples = array<vector<uint64_t>, RequestScheduler::ClassCount>;
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: LoopBackBench [options]\n"
+            "  --clients N          concurrent clients (16)\n"
+            "  --operations N       operations per client (500)\n"
+            "  --containers N       containers the backend enumerates (2000)\n"
+            "  --bulk-size N        SIDs per bulk change (100)\n"
+            "  --latency-scale X    multiplies the simulated backend latencies (1.0)\n"
+            "  --seed N             seed of the operation mix (1)\n"
+            "  --no-scheduler       commit without the scheduler, which should lose updates\n");
+    }
+
+    const bool ParseOptions(const int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const string name = argv[i];
+            const auto value = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+            if (name == "--clients") { options.Clients = static_cast<uint32_t>(strtoul(value(), nullptr, 10)); }
+            else if (name == "--operations") { options.Operations = static_cast<uint32_t>(strtoul(value(), nullptr, 10)); }
+            else if (name == "--containers") { options.Containers = static_cast<uint32_t>(strtoul(value(), nullptr, 10)); }
+            else if (name == "--bulk-size") { options.BulkSize = static_cast<uint32_t>(strtoul(value(), nullptr, 10)); }
+            else if (name == "--latency-scale") { options.LatencyScale = strtod(value(), nullptr); }
+            else if (name == "--seed") { options.Seed = static_cast<uint32_t>(strtoul(value(), nullptr, 10)); }
+            else if (name == "--no-scheduler") { options.IsScheduled = false; }
+            else { return false; }
+        }
+        return options.Clients > 0 && options.BulkSize > 0 && options.BulkSize <= options.SidsPerClient && options.LatencyScale >= 0;
+    }
+
+    const uint64_t SteadyMilliseconds()
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    wstring GetSid(const uint32_t client, const uint32_t key)
+    {
+        return L"S-1-15-2-" + to_wstring(client) + L"-" + to_wstring(key);
+    }
+
+    // The read-modify-write LoopUtil::ApplyLoopbackChanges does: the live list is read, the
+    // change applied, and nothing is written when it changes nothing.
+    void ApplyChanges(SimulatedBackend& backend, const vector<wstring>& list, const bool isAdd)
+    {
+        const vector<wstring> config = backend.GetConfig();
+        unordered_set<wstring> result(config.begin(), config.end());
+        bool isChanged = false;
+        for (const wstring& sid : list)
+        {
+            isChanged |= isAdd ? result.insert(sid).second : result.erase(sid) > 0;
+        }
+        if (isChanged)
+        {
+            backend.SetConfig(vector<wstring>(result.begin(), result.end()));
+        }
+    }
+
+    // One client of the server. Every client owns its own SIDs, so the exemptions it expects
+    // to be left over are known without coordinating with the others.
+    struct Client
+    {
+        uint32_t Id;
+        unordered_set<wstring> Expected;
+        Samples Latencies;
+
+        void Run(const Options& options, SimulatedBackend& backend, RequestScheduler& scheduler)
+        {
+            mt19937 random(options.Seed * 7919 + Id);
+            uniform_int_distribution<uint32_t> keys(0, options.SidsPerClient - 1);
+
+            const auto commit = [&](const RequestClass requestClass, const vector<wstring>& list, const bool isAdd)
+                {
+                    if (options.IsScheduled && list.size() > BulkChunkSize)
+                    {
+                        //Like LoopUtil::CommitLoopbackChanges, large changes give up the turn between chunks.
+                        const size_t count = (list.size() + BulkChunkSize - 1) / BulkChunkSize;
+                        scheduler.RunChunked(RequestClass::Bulk, count, [&](const size_t index)
+                            {
+                                const auto first = list.begin() + index * BulkChunkSize;
+                                ApplyChanges(backend, vector<wstring>(first, first + min(BulkChunkSize, static_cast<size_t>(list.end() - first))), isAdd);
+                                return true;
+                            });
+                    }
+                    else if (options.IsScheduled)
+                    {
+                        scheduler.Run(requestClass, [&]() { ApplyChanges(backend, list, isAdd); });
+                    }
+                    else
+                    {
+                        ApplyChanges(backend, list, isAdd);
+                    }
+                    for (const wstring& sid : list)
+                    {
+                        if (isAdd) { Expected.insert(sid); }
+                        else { Expected.erase(sid); }
+                    }
+                };
+
+            for (uint32_t operation = 0; operation < options.Operations; operation++)
+            {
+                //The mix of a busy server: mostly reads and single toggles, some expiry passes
+                //and the occasional bulk change.
+                const uint32_t roll = random() % 100;
+                const RequestClass requestClass = roll < 70 ? RequestClass::InteractiveRead
+                    : roll < 92 ? RequestClass::InteractiveWrite
+                    : roll < 97 ? RequestClass::BackgroundRefresh
+                    : RequestClass::Bulk;
+
+                const auto started = chrono::steady_clock::now();
+                switch (requestClass)
+                {
+                case RequestClass::InteractiveRead:
+                    //Reads are admitted in order and then run without the turn.
+                    if (options.IsScheduled) { scheduler.Admit(requestClass); }
+                    backend.Enumerate();
+                    break;
+                case RequestClass::InteractiveWrite:
+                {
+                    const wstring sid = GetSid(Id, keys(random));
+                    commit(requestClass, { sid }, !Expected.contains(sid));
+                    break;
+                }
+                case RequestClass::BackgroundRefresh:
+                {
+                    //An expiry pass removes a few of the exemptions that are due.
+                    vector<wstring> expired;
+                    for (auto item = Expected.begin(); item != Expected.end() && expired.size() < 8; ++item)
+                    {
+                        expired.push_back(*item);
+                    }
+                    commit(requestClass, expired, false);
+                    break;
+                }
+                case RequestClass::Bulk:
+                {
+                    unordered_set<wstring> list;
+                    while (list.size() < options.BulkSize)
+                    {
+                        list.insert(GetSid(Id, keys(random)));
+                    }
+                    commit(requestClass, vector<wstring>(list.begin(), list.end()), random() % 2 == 0);
+                    break;
+                }
+                }
+                const auto elapsed = chrono::steady_clock::now() - started;
+                Latencies[static_cast<size_t>(requestClass)].push_back(static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(elapsed).count()));
+            }
+        }
+    };
+
+    const double GetPercentile(const vector<uint64_t>& sorted, const double percentile)
+    {
+        if (sorted.empty()) { return 0; }
+        const size_t rank = static_cast<size_t>(ceil(percentile * sorted.size()));
+        return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1] / 1000.0;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    const auto scale = [&](const int64_t microseconds) { return chrono::microseconds(static_cast<int64_t>(microseconds * options.LatencyScale)); };
+    SimulatedBackend backend(options.Containers, { scale(2000), scale(200), scale(500) });
+    RequestScheduler scheduler(SteadyMilliseconds, 2000);
+
+    printf("LoopBack.Bench: %u clients x %u operations, %u containers, latency scale %.2f, %s\n",
+        options.Clients, options.Operations, options.Containers, options.LatencyScale,
+        options.IsScheduled ? "scheduled" : "unscheduled");
+
+    vector<Client> clients(options.Clients);
+    vector<thread> threads;
+    atomic<bool> isStarted = false;
+    for (uint32_t i = 0; i < options.Clients; i++)
+    {
+        clients[i].Id = i;
+        threads.emplace_back([&, i]()
+            {
+                while (!isStarted) { this_thread::yield(); }
+                clients[i].Run(options, backend, scheduler);
+            });
+    }
+
+    const auto started = chrono::steady_clock::now();
+    isStarted = true;
+    for (thread& item : threads) { item.join(); }
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    printf("\n%-18s %8s %10s %10s %10s %10s\n", "class", "count", "p50 ms", "p99 ms", "p999 ms", "ops/s");
+    uint64_t total = 0;
+    for (size_t requestClass = 0; requestClass < RequestScheduler::ClassCount; requestClass++)
+    {
+        vector<uint64_t> samples;
+        for (const Client& client : clients)
+        {
+            samples.insert(samples.end(), client.Latencies[requestClass].begin(), client.Latencies[requestClass].end());
+        }
+        sort(samples.begin(), samples.end());
+        total += samples.size();
+        printf("%-18s %8zu %10.2f %10.2f %10.2f %10.1f\n", ClassNames[requestClass], samples.size(),
+            GetPercentile(samples, 0.50), GetPercentile(samples, 0.99), GetPercentile(samples, 0.999),
+            samples.size() / seconds);
+    }
+    printf("%-18s %8llu in %.2f s, %.1f ops/s, %llu commits\n", "total", static_cast<unsigned long long>(total), seconds,
+        total / seconds, static_cast<unsigned long long>(backend.SetCount()));
+
+    if (options.IsScheduled)
+    {
+        printf("\n%-18s %10s %12s %12s\n", "scheduler", "completed", "mean wait", "max wait");
+        const auto metrics = scheduler.GetMetrics();
+        for (size_t requestClass = 0; requestClass < RequestScheduler::ClassCount; requestClass++)
+        {
+            const RequestScheduler::ClassMetrics& item = metrics[requestClass];
+            printf("%-18s %10llu %10.1fms %10llums\n", ClassNames[requestClass], static_cast<unsigned long long>(item.Completed),
+                item.Completed ? static_cast<double>(item.TotalWait) / item.Completed : 0.0, static_cast<unsigned long long>(item.MaxWait));
+        }
+    }
+
+    //Every client knows which of its SIDs it left exempted, so anything else is a lost or stray update.
+    unordered_set<wstring> expected;
+    for (const Client& client : clients)
+    {
+        expected.insert(client.Expected.begin(), client.Expected.end());
+    }
+    const vector<wstring> config = backend.GetConfig();
+    const unordered_set<wstring> actual(config.begin(), config.end());
+    size_t missing = 0;
+    size_t unexpected = 0;
+    for (const wstring& sid : expected) { missing += actual.contains(sid) ? 0 : 1; }
+    for (const wstring& sid : actual) { unexpected += expected.contains(sid) ? 0 : 1; }
+    const bool isCorrect = missing == 0 && unexpected == 0 && actual.size() == config.size();
+
+    printf("\nfinal state: %zu exemptions, %zu expected, %zu missing, %zu unexpected, %zu duplicates: %s\n",
+        actual.size(), expected.size(), missing, unexpected, config.size() - actual.size(), isCorrect ? "OK" : "FAILED");
+    return isCorrect ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "BenchHelpers.h"
+#include "GlobSet.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::GlobPattern;
+using winrt::LoopBack::Metadata::implementation::GlobSet;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Rules = 1000;
+        uint32_t Containers = 10000;
+        // Containers per thousand that an incremental pass finds added or changed.
+        uint32_t ChangedPerMille = 10;
+        uint32_t Iterations = 5;
+        uint32_t Seed = 1;
+    };
+
+    // Family names are generated folded, the way ExemptionRuleEngine hands them to GlobSet.
+    wstring GetPublisherId(const uint32_t publisher)
+    {
+        wstring result = L"8WEKYB3D8BB";
+        result.append(to_wstring(publisher % 100));
+        return result;
+    }
+
+    wstring GetFamilyName(const uint32_t publisher, const uint32_t app)
+    {
+        return L"PUBLISHER" + to_wstring(publisher) + L".APP" + to_wstring(app) + L"_" + GetPublisherId(publisher);
+    }
+
+    // The rule mix of a fleet policy: mostly whole publishers and exact packages, some
+    // publisher-wide suffixes and a few patterns without an anchor.
+    const vector<wstring> GetRules(const Options& options, mt19937& random)
+    {
+        const uint32_t publishers = max<uint32_t>(options.Containers / 10, 1);
+        vector<wstring> rules;
+        for (uint32_t i = 0; i < options.Rules; i++)
+        {
+            const uint32_t publisher = random() % (publishers * 2);
+            const uint32_t roll = i % 20;
+            if (roll < 8) { rules.push_back(GetFamilyName(publisher, random() % 20)); }
+            else if (roll < 16) { rules.push_back(L"PUBLISHER" + to_wstring(publisher) + L".*_" + GetPublisherId(publisher)); }
+            else if (roll < 19) { rules.push_back(L"*.APP" + to_wstring(random() % 40) + L"_" + GetPublisherId(publisher)); }
+            else { rules.push_back(L"*APP" + to_wstring(random() % 1000) + L"*"); }
+        }
+        return rules;
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: RuleEvaluationBench [options]\n"
+            "  --rules N            family name rules (1000)\n"
+            "  --containers N       containers in the snapshot (10000)\n"
+            "  --changed N          containers per thousand an incremental pass re-matches (10)\n"
+            "  --iterations N       measured runs per pass (5)\n"
+            "  --seed N             seed of the generated names (1)\n");
+    }
+}
+
+// Evaluates family name rules against a snapshot the way ExemptionRuleEngine does: a full
+// pass runs the GlobSet over every container, and a pass over a merged snapshot only runs it
+// over the containers MergeFrom found added or changed. Every pattern tried against every
+// container is measured as the baseline, and both have to agree. Capability and literal
+// family rules are index lookups of the snapshot and working directories go through a
+// PathTrie, which needs the Windows case folding, so neither is part of this benchmark.
+int main(const int argc, char** argv)
+{
+    Options options;
+    OptionParser parser;
+    parser.Add("--rules", options.Rules);
+    parser.Add("--containers", options.Containers);
+    parser.Add("--changed", options.ChangedPerMille);
+    parser.Add("--iterations", options.Iterations);
+    parser.Add("--seed", options.Seed);
+    if (!parser.Parse(argc, argv) || options.Containers == 0 || options.ChangedPerMille > 1000)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    mt19937 random(options.Seed);
+    vector<wstring> familyNames;
+    for (uint32_t i = 0; i < options.Containers; i++)
+    {
+        familyNames.push_back(GetFamilyName(i / 10, i % 10 + random() % 10));
+    }
+    const vector<wstring> rules = GetRules(options, random);
+
+    GlobSet set;
+    const double compile = MeasureMedian(options.Iterations, [&]()
+        {
+            set.Clear();
+            for (const wstring& rule : rules) { set.Add(rule); }
+        });
+
+    vector<bool> matched(familyNames.size());
+    const double full = MeasureMedian(options.Iterations, [&]()
+        {
+            for (size_t i = 0; i < familyNames.size(); i++) { matched[i] = set.Match(familyNames[i]); }
+        });
+
+    //Containers that kept their base index carry the previous result over.
+    vector<uint32_t> dirty;
+    for (uint32_t i = 0; i < options.Containers; i++)
+    {
+        if (random() % 1000 < options.ChangedPerMille) { dirty.push_back(i); }
+    }
+    vector<bool> merged;
+    const double incremental = MeasureMedian(options.Iterations, [&]()
+        {
+            merged = matched;
+            for (const uint32_t i : dirty) { merged[i] = set.Match(familyNames[i]); }
+        });
+
+    vector<GlobPattern> patterns(rules.begin(), rules.end());
+    vector<bool> expected(familyNames.size());
+    const double naive = MeasureMedian(options.Iterations, [&]()
+        {
+            for (size_t i = 0; i < familyNames.size(); i++)
+            {
+                expected[i] = any_of(patterns.begin(), patterns.end(), [&](const GlobPattern& pattern) { return pattern.Match(familyNames[i]); });
+            }
+        });
+
+    size_t matches = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < familyNames.size(); i++)
+    {
+        matches += matched[i] ? 1 : 0;
+        mismatches += matched[i] != expected[i] ? 1 : 0;
+    }
+
+    printf("RuleEvaluationBench: %u rules x %u containers, %zu changed, %zu matched\n\n",
+        options.Rules, options.Containers, dirty.size(), matches);
+    printf("%-22s %10s %14s\n", "pass", "ms", "ns/container");
+    printf("%-22s %10.3f %14s\n", "compile", compile, "-");
+    printf("%-22s %10.3f %14.1f\n", "full", full, full * 1e6 / options.Containers);
+    printf("%-22s %10.3f %14.1f\n", "incremental", incremental, incremental * 1e6 / options.Containers);
+    printf("%-22s %10.3f %14.1f\n", "every rule (baseline)", naive, naive * 1e6 / options.Containers);
+
+    printf("\nresults: %zu mismatches against the baseline: %s\n", mismatches, mismatches == 0 ? "OK" : "FAILED");
+    return mismatches == 0 ? 0 : 1;
+}
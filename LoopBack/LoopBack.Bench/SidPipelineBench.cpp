@@ -0,0 +1,179 @@
+#include "BenchHelpers.h"
+#include "StringSid.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace LoopBackBench;
+using winrt::LoopBack::Metadata::implementation::MaxSidSize;
+using winrt::LoopBack::Metadata::implementation::ParseStringSid;
+
+namespace
+{
+    atomic<uint64_t> allocations = 0;
+}
+
+// Every heap allocation of the process is counted, so each pass can report how many it made.
+void* operator new(const size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* block = malloc(size ? size : 1)) { return block; }
+    throw bad_alloc();
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+
+namespace
+{
+    struct Options
+    {
+        uint32_t Sids = 10000;
+        uint32_t Iterations = 5;
+        uint32_t Seed = 1;
+    };
+
+    // Stands in for SID_AND_ATTRIBUTES, which points at a SID and carries its flags.
+    struct SidEntry
+    {
+        const uint8_t* Sid;
+        uint32_t Attributes;
+    };
+
+    // The commit before the fused pipeline: the input is copied into a string list first, every
+    // SID is converted into a block of its own the way ConvertStringSidToSid allocates it, and
+    // the entries are built from those blocks in a second pass.
+    const size_t CommitCopied(const vector<wstring>& input, vector<unique_ptr<uint8_t[]>>& sids, vector<SidEntry>& entries)
+    {
+        const vector<wstring> list(input.begin(), input.end());
+        sids.clear();
+        unordered_set<wstring> seenSet;
+        for (const wstring& stringSid : list)
+        {
+            if (!seenSet.insert(stringSid).second) { continue; }
+            uint8_t buffer[MaxSidSize];
+            const uint32_t length = ParseStringSid(stringSid, buffer);
+            if (!length) { continue; }
+            sids.emplace_back(new uint8_t[length]);
+            memcpy(sids.back().get(), buffer, length);
+        }
+        entries.clear();
+        for (const unique_ptr<uint8_t[]>& sid : sids)
+        {
+            entries.push_back({ sid.get(), 0 });
+        }
+        return entries.size();
+    }
+
+    // What SidArray does: every SID is parsed straight into one byte buffer, duplicates are
+    // dropped by the bytes they parsed to, and the entries are built once the list is complete.
+    const size_t CommitFused(const vector<wstring>& input, vector<uint8_t>& bytes, vector<uint32_t>& offsets, unordered_set<string_view>& keys, vector<SidEntry>& entries)
+    {
+        bytes.clear();
+        offsets.clear();
+        keys.clear();
+        //The keys point into the buffer, so it is sized for the largest input up front.
+        bytes.reserve(input.size() * MaxSidSize);
+        for (const wstring& stringSid : input)
+        {
+            uint8_t buffer[MaxSidSize];
+            const uint32_t length = ParseStringSid(stringSid, buffer);
+            if (!length) { continue; }
+            const uint32_t offset = static_cast<uint32_t>(bytes.size());
+            bytes.insert(bytes.end(), buffer, buffer + length);
+            if (!keys.insert(string_view(reinterpret_cast<const char*>(bytes.data() + offset), length)).second)
+            {
+                bytes.resize(offset);
+                continue;
+            }
+            offsets.push_back(offset);
+        }
+        entries.clear();
+        for (const uint32_t offset : offsets)
+        {
+            entries.push_back({ bytes.data() + offset, 0 });
+        }
+        return entries.size();
+    }
+
+    void PrintUsage()
+    {
+        printf(
+            "Usage: SidPipelineBench [options]\n"
+            "  --sids N             SID strings committed per pass (10000)\n"
+            "  --iterations N       measured runs per pipeline (5)\n"
+            "  --seed N             seed of the generated SIDs (1)\n");
+    }
+}
+
+// Latency and heap allocations of turning SID strings into the SID list of a commit, with
+// the copied, one block per SID shape of the old commit paths against the single buffer of
+// SidArray. Both parse with ParseStringSid; SidArray itself validates through the Windows SID
+// functions, so the fused pass follows its layout here. Both have to keep the same SIDs.
+int main(const int argc, char** argv)
+{
+    Options options;
+    OptionParser parser;
+    parser.Add("--sids", options.Sids);
+    parser.Add("--iterations", options.Iterations);
+    parser.Add("--seed", options.Seed);
+    if (!parser.Parse(argc, argv) || options.Sids == 0)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    mt19937 random(options.Seed);
+    vector<wstring> input;
+    for (uint32_t i = 0; i < options.Sids; i++)
+    {
+        //A few percent of the input repeats an earlier SID, as lists built by hand do.
+        if (i > 0 && random() % 50 == 0) { input.push_back(input[random() % input.size()]); continue; }
+        input.push_back(L"S-1-15-2-" + to_wstring(random()) + L"-" + to_wstring(random()) + L"-" + to_wstring(random())
+            + L"-" + to_wstring(random()) + L"-" + to_wstring(random()) + L"-" + to_wstring(random()) + L"-" + to_wstring(random()));
+    }
+
+    vector<unique_ptr<uint8_t[]>> sids;
+    vector<SidEntry> copiedEntries;
+    vector<SidEntry> fusedEntries;
+    vector<uint8_t> bytes;
+    vector<uint32_t> offsets;
+    unordered_set<string_view> keys;
+    const auto measure = [&](auto&& body, uint64_t& perPass)
+        {
+            const double elapsed = MeasureMedian(options.Iterations, body);
+            const uint64_t before = allocations.load();
+            body();
+            perPass = allocations.load() - before;
+            return elapsed;
+        };
+
+    uint64_t copiedAllocations = 0;
+    uint64_t fusedAllocations = 0;
+    const double copied = measure([&]() { CommitCopied(input, sids, copiedEntries); }, copiedAllocations);
+    const double fused = measure([&]() { CommitFused(input, bytes, offsets, keys, fusedEntries); }, fusedAllocations);
+
+    bool isCorrect = copiedEntries.size() == fusedEntries.size();
+    for (size_t i = 0; isCorrect && i < copiedEntries.size(); i++)
+    {
+        const uint32_t length = 8 + 4 * copiedEntries[i].Sid[1];
+        isCorrect = memcmp(copiedEntries[i].Sid, fusedEntries[i].Sid, length) == 0;
+    }
+
+    printf("SidPipelineBench: %u SID strings, %zu distinct\n\n", options.Sids, fusedEntries.size());
+    printf("%-22s %10s %14s %12s\n", "pipeline", "ms", "ns/SID", "allocations");
+    printf("%-22s %10.3f %14.1f %12llu\n", "copied, block per SID", copied, copied * 1e6 / options.Sids, static_cast<unsigned long long>(copiedAllocations));
+    printf("%-22s %10.3f %14.1f %12llu\n", "fused single buffer", fused, fused * 1e6 / options.Sids, static_cast<unsigned long long>(fusedAllocations));
+
+    printf("\nresults: %s\n", isCorrect ? "same SIDs in the same order: OK" : "the pipelines disagree: FAILED");
+    return isCorrect ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#include "SimulatedBackend.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace LoopBackBench
+{
+    SimulatedBackend::SimulatedBackend(const uint32_t containerCount, const Latency& latency) : containerCount(containerCount), latency(latency)
+    {
+    }
+
+    const uint32_t SimulatedBackend::Enumerate()
+    {
+        size_t exempted;
+        {
+            const lock_guard<mutex> guard(lock);
+            exempted = config.size();
+        }
+        this_thread::sleep_for(latency.Enumerate);
+        return static_cast<uint32_t>(min<size_t>(exempted, containerCount));
+    }
+
+    const vector<wstring> SimulatedBackend::GetConfig()
+    {
+        vector<wstring> result;
+        {
+            const lock_guard<mutex> guard(lock);
+            result = config;
+        }
+        //The copy is taken first, so a set that lands during the call is not seen.
+        this_thread::sleep_for(latency.GetConfig);
+        return result;
+    }
+
+    void SimulatedBackend::SetConfig(vector<wstring> list)
+    {
+        this_thread::sleep_for(latency.SetConfig);
+        const lock_guard<mutex> guard(lock);
+        config = move(list);
+        setCount++;
+    }
+}
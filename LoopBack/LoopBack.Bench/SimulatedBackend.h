@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LoopBackBench
+{
+    // In-memory stand-in for the firewall service behind NetworkIsolationEnumAppContainers,
+    // NetworkIsolationGetAppContainerConfig and NetworkIsolationSetAppContainerConfig. Every
+    // call takes a configured time. Like the real service it has no transactions: the list a
+    // reader got is a copy, and a set replaces the whole list, so two read-modify-writes that
+    // overlap lose one of the updates unless the caller serializes them.
+    struct SimulatedBackend
+    {
+        struct Latency
+        {
+            std::chrono::microseconds Enumerate;
+            std::chrono::microseconds GetConfig;
+            std::chrono::microseconds SetConfig;
+        };
+
+        SimulatedBackend(const uint32_t containerCount, const Latency& latency);
+
+        // Walks every container and returns how many of them are exempted.
+        const uint32_t Enumerate();
+        const std::vector<std::wstring> GetConfig();
+        void SetConfig(std::vector<std::wstring> list);
+
+        const uint64_t SetCount() const { return setCount; }
+
+    private:
+        std::mutex lock;
+        std::vector<std::wstring> config;
+        uint32_t containerCount;
+        Latency latency;
+        std::atomic<uint64_t> setCount = 0;
+    };
+}
@@ -5,9 +5,17 @@
 using namespace winrt;
 using namespace Windows::Foundation::Collections;
 
+// Private interface of containers created in this process. It is not registered for
+// marshalling, so a proxy of a container from another process never answers it.
+struct __declspec(uuid("929b03fb-f456-4e86-b939-3699170bb7c8")) __declspec(novtable) IAppContainerNative : ::IUnknown
+{
+    // Gets the SID string without an hstring copy; it stays valid while the container is unchanged.
+    virtual HRESULT STDMETHODCALLTYPE GetAppContainerSid(PCWSTR* value, UINT32* length) noexcept = 0;
+};
+
 namespace winrt::LoopBack::Metadata::implementation
 {
-    struct AppContainer : AppContainerT<AppContainer>
+    struct AppContainer : AppContainerT<AppContainer, IAppContainerNative>
     {
         AppContainer() = default;
 
@@ -21,6 +29,7 @@ namespace winrt::LoopBack::Metadata::implementation
         hstring UserSid() const { return userSid; }
         IVector<hstring> Capabilities() const { return capabilities; }
         IVector<hstring> Binaries() const { return binaries; }
+        AppContainerFields Fields() const { return fields; }
 
         void IsEnableLoop(const bool value) { isEnableLoop = value; }
         void DisplayName(const hstring& value) { displayName = value; }
@@ -32,9 +41,17 @@ namespace winrt::LoopBack::Metadata::implementation
         void UserSid(const hstring& value) { userSid = value; }
         void Capabilities(const IVector<hstring>& value) { capabilities = value; }
         void Binaries(const IVector<hstring>& value) { binaries = value; }
+        void Fields(const AppContainerFields& value) { fields = value; }
 
         hstring ToString() const;
 
+        HRESULT STDMETHODCALLTYPE GetAppContainerSid(PCWSTR* value, UINT32* length) noexcept override
+        {
+            *value = appContainerSid.c_str();
+            *length = appContainerSid.size();
+            return S_OK;
+        }
+
     private:
         bool isEnableLoop = false;
         hstring displayName = L"";
@@ -46,6 +63,7 @@ namespace winrt::LoopBack::Metadata::implementation
         hstring userSid = L"";
         IVector<hstring> capabilities = nullptr;
         IVector<hstring> binaries = nullptr;
+        AppContainerFields fields = AppContainerFields::All;
     };
 }
 
@@ -0,0 +1,3 @@
+#include "pch.h"
+#include "AppContainerChange.h"
+#include "AppContainerChange.g.cpp"
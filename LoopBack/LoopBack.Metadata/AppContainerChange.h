@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AppContainerChange.g.h"
+
+using namespace winrt;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    struct AppContainerChange : AppContainerChangeT<AppContainerChange>
+    {
+        AppContainerChange(
+            const AppContainerChangeKind kind,
+            const AppContainerFields changedFields,
+            const LoopBack::Metadata::AppContainer& oldValue,
+            const LoopBack::Metadata::AppContainer& newValue)
+            : kind(kind), changedFields(changedFields), oldValue(oldValue), newValue(newValue) {}
+
+        const AppContainerChangeKind Kind() const { return kind; }
+        const AppContainerFields ChangedFields() const { return changedFields; }
+        LoopBack::Metadata::AppContainer OldValue() const { return oldValue; }
+        LoopBack::Metadata::AppContainer NewValue() const { return newValue; }
+
+    private:
+        AppContainerChangeKind kind;
+        AppContainerFields changedFields;
+        LoopBack::Metadata::AppContainer oldValue;
+        LoopBack::Metadata::AppContainer newValue;
+    };
+}
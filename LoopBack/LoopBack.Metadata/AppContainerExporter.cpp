@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "AppContainerExporter.h"
+#include "ClientImpersonation.h"
+#include "JsonEscape.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    AppContainerExporter::AppContainerExporter(const wstring_view path, const AppContainerExportFormat format) : format(format)
+    {
+        //The server may run elevated, so the file is only opened with the client's own rights.
+        const ClientImpersonation impersonation;
+        file.attach(CreateFile(
+            wstring(path).c_str(),
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (!file) { throw_last_error(); }
+    }
+
+    void AppContainerExporter::Begin()
+    {
+        if (format == AppContainerExportFormat::Json)
+        {
+            WriteRaw("[");
+        }
+        else
+        {
+            WriteRaw("AppContainerName,DisplayName,Description,PackageFullName,WorkingDirectory,AppContainerSid,UserSid,IsEnableLoop,Capabilities,Binaries\r\n");
+        }
+    }
+
+    void AppContainerExporter::Write(const INET_FIREWALL_APP_CONTAINER& app, const bool isEnableLoop)
+    {
+        const bool isJson = format == AppContainerExportFormat::Json;
+        if (isJson)
+        {
+            WriteRaw(isFirst ? "\n{\"appContainerName\":" : ",\n{\"appContainerName\":");
+        }
+        isFirst = false;
+
+        WriteString(app.appContainerName);
+        WriteSeparator(",\"displayName\":");
+        WriteString(app.displayName);
+        WriteSeparator(",\"description\":");
+        WriteString(app.description);
+        WriteSeparator(",\"packageFullName\":");
+        WriteString(app.packageFullName);
+        WriteSeparator(",\"workingDirectory\":");
+        WriteString(app.workingDirectory);
+        WriteSeparator(",\"appContainerSid\":");
+        WriteSid(app.appContainerSid);
+        WriteSeparator(",\"userSid\":");
+        WriteSid(app.userSid);
+        WriteSeparator(",\"isEnableLoop\":");
+        WriteRaw(isEnableLoop ? "true" : "false");
+        WriteSeparator(",\"capabilities\":");
+        WriteSidList(app.capabilities.capabilities, app.capabilities.count);
+        WriteSeparator(",\"binaries\":");
+        WriteList(app.binaries.binaries, app.binaries.count);
+        WriteRaw(isJson ? "}" : "\r\n");
+    }
+
+    void AppContainerExporter::End()
+    {
+        if (format == AppContainerExportFormat::Json)
+        {
+            WriteRaw("\n]\n");
+        }
+        Flush();
+    }
+
+    void AppContainerExporter::Flush()
+    {
+        if (!length) { return; }
+        DWORD written = 0;
+        check_bool(WriteFile(file.get(), buffer.data(), static_cast<DWORD>(length), &written, nullptr));
+        bytesWritten += written;
+        length = 0;
+    }
+
+    void AppContainerExporter::WriteRaw(string_view value)
+    {
+        while (!value.empty())
+        {
+            if (length == buffer.size()) { Flush(); }
+            const size_t count = min(value.size(), buffer.size() - length);
+            memcpy(buffer.data() + length, value.data(), count);
+            length += count;
+            value.remove_prefix(count);
+        }
+    }
+
+    void AppContainerExporter::WriteString(const PCWSTR value)
+    {
+        const string_view text = ToUtf8(value);
+        escaped.clear();
+        if (format == AppContainerExportFormat::Json)
+        {
+            escaped.push_back('"');
+            EscapeJson(text, escaped);
+            escaped.push_back('"');
+        }
+        else
+        {
+            //CSV fields are always quoted, with embedded quotes doubled.
+            escaped.push_back('"');
+            for (const char c : text)
+            {
+                if (c == '"') { escaped.push_back('"'); }
+                escaped.push_back(c);
+            }
+            escaped.push_back('"');
+        }
+        WriteRaw(escaped);
+    }
+
+    void AppContainerExporter::WriteSid(const PSID sid)
+    {
+        LPWSTR stringSid = nullptr;
+        if (sid && ConvertSidToStringSid(sid, &stringSid) && stringSid)
+        {
+            WriteString(stringSid);
+            LocalFree(stringSid);
+        }
+        else
+        {
+            WriteString(nullptr);
+        }
+    }
+
+    void AppContainerExporter::WriteSeparator(const char* json)
+    {
+        WriteRaw(format == AppContainerExportFormat::Json ? json : ",");
+    }
+
+    void AppContainerExporter::WriteList(const PCWSTR* values, const DWORD count)
+    {
+        if (format == AppContainerExportFormat::Json)
+        {
+            WriteRaw("[");
+            for (DWORD i = 0; values && i < count; i++)
+            {
+                if (i) { WriteRaw(","); }
+                WriteString(values[i]);
+            }
+            WriteRaw("]");
+            return;
+        }
+
+        //A CSV cell holds the whole list separated by semicolons.
+        wstring joined;
+        for (DWORD i = 0; values && i < count; i++)
+        {
+            if (!values[i]) { continue; }
+            if (!joined.empty()) { joined.push_back(L';'); }
+            joined.append(values[i]);
+        }
+        WriteString(joined.c_str());
+    }
+
+    void AppContainerExporter::WriteSidList(const SID_AND_ATTRIBUTES* values, const DWORD count)
+    {
+        vector<LPWSTR> sids;
+        for (DWORD i = 0; values && i < count; i++)
+        {
+            LPWSTR stringSid = nullptr;
+            if (values[i].Sid && ConvertSidToStringSid(values[i].Sid, &stringSid) && stringSid)
+            {
+                sids.push_back(stringSid);
+            }
+        }
+        WriteList(sids.data(), static_cast<DWORD>(sids.size()));
+        for (const LPWSTR stringSid : sids)
+        {
+            LocalFree(stringSid);
+        }
+    }
+
+    const string_view AppContainerExporter::ToUtf8(const PCWSTR value)
+    {
+        if (!value || !*value) { return {}; }
+        const int size = WideCharToMultiByte(CP_UTF8, 0, value, -1, nullptr, 0, nullptr, nullptr);
+        if (size <= 1) { return {}; }
+        utf8.resize(static_cast<size_t>(size));
+        WideCharToMultiByte(CP_UTF8, 0, value, -1, utf8.data(), size, nullptr, nullptr);
+        return string_view(utf8.data(), static_cast<size_t>(size - 1));
+    }
+}
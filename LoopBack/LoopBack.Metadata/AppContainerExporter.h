@@ -0,0 +1,46 @@
+#pragma once
+
+#include <winrt/LoopBack.Metadata.h>
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Streams enumerated containers to a UTF-8 file as JSON or CSV straight from the
+    // INET_FIREWALL_APP_CONTAINER records, without building AppContainer objects. Output
+    // goes through a fixed size buffer, so memory use does not grow with the container count.
+    struct AppContainerExporter
+    {
+        static constexpr size_t BufferSize = 64 * 1024;
+
+        AppContainerExporter(const std::wstring_view path, const AppContainerExportFormat format);
+
+        void Begin();
+        void Write(const INET_FIREWALL_APP_CONTAINER& app, const bool isEnableLoop);
+        void End();
+
+        const uint64_t BytesWritten() const { return bytesWritten; }
+
+    private:
+        file_handle file;
+        AppContainerExportFormat format;
+        std::array<char, BufferSize> buffer;
+        size_t length = 0;
+        uint64_t bytesWritten = 0;
+        bool isFirst = true;
+        std::string utf8;
+        std::string escaped;
+
+        void Flush();
+        void WriteRaw(const std::string_view value);
+        void WriteString(const PCWSTR value);
+        void WriteSid(const PSID sid);
+        void WriteSeparator(const char* json);
+        void WriteList(const PCWSTR* values, const DWORD count);
+        void WriteSidList(const SID_AND_ATTRIBUTES* values, const DWORD count);
+        const std::string_view ToUtf8(const PCWSTR value);
+    };
+}
@@ -0,0 +1,517 @@
+#include "pch.h"
+#include "AppContainerSnapshot.h"
+#include "AppContainerChange.h"
+#include "ContentHash.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <unordered_set>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    PackageIdentity PackageIdentity::Parse(const wstring_view packageFullName)
+    {
+        PackageIdentity identity;
+
+        wstring_view parts[5];
+        size_t count = 0;
+        size_t start = 0;
+        bool isComplete = false;
+        while (count < 5)
+        {
+            const size_t end = packageFullName.find(L'_', start);
+            parts[count++] = packageFullName.substr(start, end == wstring_view::npos ? wstring_view::npos : end - start);
+            if (end == wstring_view::npos)
+            {
+                isComplete = true;
+                break;
+            }
+            start = end + 1;
+        }
+
+        if (count != 5 || !isComplete)
+        {
+            //Not a package full name, so the whole string is the best family name we have.
+            identity.Name = packageFullName;
+            identity.FamilyName = packageFullName;
+            return identity;
+        }
+
+        identity.Name = parts[0];
+        identity.Version = ParseVersion(parts[1]);
+        identity.Architecture = parts[2];
+        identity.ResourceId = parts[3];
+        identity.PublisherId = parts[4];
+        identity.FamilyName.reserve(identity.Name.size() + identity.PublisherId.size() + 1);
+        identity.FamilyName.append(identity.Name).append(1, L'_').append(identity.PublisherId);
+        return identity;
+    }
+
+    const uint64_t PackageIdentity::ParseVersion(const wstring_view version)
+    {
+        //Packed the same way as PACKAGE_VERSION: Major.Minor.Build.Revision, 16 bits each.
+        uint64_t result = 0;
+        uint64_t part = 0;
+        int shift = 48;
+        for (const wchar_t c : version)
+        {
+            if (c == L'.')
+            {
+                if (shift < 0) { break; }
+                result |= (part & 0xFFFF) << shift;
+                part = 0;
+                shift -= 16;
+            }
+            else if (c >= L'0' && c <= L'9')
+            {
+                part = part * 10 + (c - L'0');
+            }
+        }
+        if (shift >= 0)
+        {
+            result |= (part & 0xFFFF) << shift;
+        }
+        return result;
+    }
+
+    void AppContainerSnapshot::Append(const AppContainer& app)
+    {
+        const uint32_t index = Size();
+        const hstring packageFullName = app.PackageFullName();
+        PackageIdentity identity = PackageIdentity::Parse(packageFullName.empty() ? app.AppContainerName() : packageFullName);
+
+        //The same container shows up once for every user that has the package installed.
+        wstring sid = FoldCase(app.AppContainerSid());
+        wstring userSid = FoldCase(app.UserSid());
+        keys.push_back(sid + L'|' + userSid);
+        sidIndex.try_emplace(move(sid), index);
+        userIndex[move(userSid)].push_back(index);
+        if (!identity.FamilyName.empty())
+        {
+            familyIndex[FoldCase(identity.FamilyName)].push_back(index);
+        }
+        if (!identity.PublisherId.empty())
+        {
+            publisherIndex[FoldCase(identity.PublisherId)].push_back(index);
+        }
+
+        if (const IVector<hstring> binaries = app.Binaries())
+        {
+            for (const hstring& binary : binaries)
+            {
+                pathIndex.Insert(binary, index);
+            }
+        }
+        if (const hstring workingDirectory = app.WorkingDirectory(); !workingDirectory.empty())
+        {
+            pathIndex.Insert(workingDirectory, index);
+        }
+
+        vector<uint32_t>& capabilities = pendingCapabilities.emplace_back();
+        if (const IVector<hstring> values = app.Capabilities())
+        {
+            for (const hstring& capability : values)
+            {
+                const auto [item, isAdded] = capabilityIds.try_emplace(FoldCase(capability), static_cast<uint32_t>(capabilityIds.size()));
+                capabilities.push_back(item->second);
+            }
+        }
+
+        //Sums of mixed per-container hashes do not depend on the enumeration order.
+        uint64_t sidHash;
+        contentHash += Hash(app, sidHash);
+        sidHashes.push_back(sidHash);
+
+        apps.push_back(app);
+        identities.push_back(move(identity));
+    }
+
+    const uint64_t AppContainerSnapshot::ETag() const
+    {
+        uint64_t flagsHash = 0;
+        for (uint32_t i = 0; i < Size(); i++)
+        {
+            if (apps[i].IsEnableLoop())
+            {
+                flagsHash += sidHashes[i];
+            }
+        }
+        return contentHash ^ ContentHash::Mix(flagsHash + 0x9E3779B97F4A7C15ull);
+    }
+
+    void AppContainerSnapshot::Seal()
+    {
+        keyOrder.resize(apps.size());
+        for (uint32_t i = 0; i < Size(); i++)
+        {
+            keyOrder[i] = i;
+        }
+        sort(keyOrder.begin(), keyOrder.end(), [this](const uint32_t left, const uint32_t right) { return keys[left] < keys[right]; });
+
+        BuildCapabilityIndex();
+        BuildSortOrders();
+
+        //A container skipped for one user may still be in scope through another user.
+        unordered_set<wstring> seen;
+        erase_if(preservedSids, [&](const hstring& sid)
+            {
+                wstring key = FoldCase(sid);
+                return sidIndex.contains(key) || !seen.insert(move(key)).second;
+            });
+    }
+
+    void AppContainerSnapshot::BuildCapabilityIndex()
+    {
+        capabilityWords = (capabilityIds.size() + 63) / 64;
+        containerWords = (apps.size() + 63) / 64;
+        capabilityPostings.assign(capabilityIds.size() * containerWords, 0);
+        capabilitySetIds.resize(apps.size());
+        capabilitySets.clear();
+
+        unordered_map<string, uint32_t> sets;
+        vector<uint64_t> bits(capabilityWords);
+        for (uint32_t i = 0; i < Size(); i++)
+        {
+            fill(bits.begin(), bits.end(), 0);
+            for (const uint32_t capability : pendingCapabilities[i])
+            {
+                bits[capability / 64] |= 1ull << (capability % 64);
+                capabilityPostings[capability * containerWords + i / 64] |= 1ull << (i % 64);
+            }
+
+            //Most containers hold one of a handful of capability sets, so those are stored once.
+            const auto [item, isAdded] = sets.try_emplace(
+                string(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(uint64_t)),
+                static_cast<uint32_t>(sets.size()));
+            if (isAdded)
+            {
+                capabilitySets.insert(capabilitySets.end(), bits.begin(), bits.end());
+            }
+            capabilitySetIds[i] = item->second;
+        }
+
+        pendingCapabilities.clear();
+        pendingCapabilities.shrink_to_fit();
+    }
+
+    const uint64_t* AppContainerSnapshot::GetPosting(const wstring_view capabilitySid) const
+    {
+        const auto result = capabilityIds.find(FoldCase(capabilitySid));
+        return result == capabilityIds.end() ? nullptr : capabilityPostings.data() + result->second * containerWords;
+    }
+
+    const vector<uint32_t> AppContainerSnapshot::QueryByCapabilities(
+        const vector<wstring_view>& allOf,
+        const vector<wstring_view>& anyOf,
+        const vector<wstring_view>& noneOf,
+        const optional<bool> isEnableLoop) const
+    {
+        vector<uint32_t> result;
+        vector<uint64_t> bits(containerWords, ~0ull);
+
+        for (const wstring_view capability : allOf)
+        {
+            const uint64_t* posting = GetPosting(capability);
+            if (!posting) { return result; }
+            for (size_t i = 0; i < containerWords; i++) { bits[i] &= posting[i]; }
+        }
+
+        if (!anyOf.empty())
+        {
+            vector<uint64_t> any(containerWords, 0);
+            for (const wstring_view capability : anyOf)
+            {
+                if (const uint64_t* posting = GetPosting(capability))
+                {
+                    for (size_t i = 0; i < containerWords; i++) { any[i] |= posting[i]; }
+                }
+            }
+            for (size_t i = 0; i < containerWords; i++) { bits[i] &= any[i]; }
+        }
+
+        for (const wstring_view capability : noneOf)
+        {
+            if (const uint64_t* posting = GetPosting(capability))
+            {
+                for (size_t i = 0; i < containerWords; i++) { bits[i] &= ~posting[i]; }
+            }
+        }
+
+        if (isEnableLoop.has_value())
+        {
+            //The exemption flag changes after commits, so its bitmap is built on demand.
+            vector<uint64_t> enabled(containerWords, 0);
+            for (uint32_t i = 0; i < Size(); i++)
+            {
+                if (apps[i].IsEnableLoop()) { enabled[i / 64] |= 1ull << (i % 64); }
+            }
+            const uint64_t flip = *isEnableLoop ? 0 : ~0ull;
+            for (size_t i = 0; i < containerWords; i++) { bits[i] &= enabled[i] ^ flip; }
+        }
+
+        for (size_t word = 0; word < containerWords; word++)
+        {
+            uint64_t value = bits[word];
+            while (value)
+            {
+                const uint32_t index = static_cast<uint32_t>(word * 64 + countr_zero(value));
+                if (index >= Size()) { break; }
+                result.push_back(index);
+                value &= value - 1;
+            }
+        }
+
+        return result;
+    }
+
+    const bool AppContainerSnapshot::HasCapability(const uint32_t index, const wstring_view capabilitySid) const
+    {
+        const auto result = capabilityIds.find(FoldCase(capabilitySid));
+        if (result == capabilityIds.end()) { return false; }
+        const uint64_t* bits = capabilitySets.data() + capabilitySetIds[index] * capabilityWords;
+        return (bits[result->second / 64] & (1ull << (result->second % 64))) != 0;
+    }
+
+    void AppContainerSnapshot::BuildSortOrders()
+    {
+        searchNames.resize(apps.size());
+        searchPackages.resize(apps.size());
+        for (uint32_t i = 0; i < Size(); i++)
+        {
+            searchNames[i] = FoldCase(apps[i].DisplayName());
+            searchPackages[i] = FoldCase(apps[i].PackageFullName());
+        }
+
+        vector<string> keys(apps.size());
+        for (uint32_t column = 1; column < SortColumnCount; column++)
+        {
+            for (uint32_t i = 0; i < Size(); i++)
+            {
+                const AppContainer& app = apps[i];
+                switch (static_cast<AppContainerSortColumn>(column))
+                {
+                case AppContainerSortColumn::DisplayName: keys[i] = GetSortKey(app.DisplayName()); break;
+                case AppContainerSortColumn::AppContainerName: keys[i] = GetSortKey(app.AppContainerName()); break;
+                case AppContainerSortColumn::WorkingDirectory: keys[i] = GetSortKey(app.WorkingDirectory()); break;
+                case AppContainerSortColumn::PackageFullName: keys[i] = GetSortKey(app.PackageFullName()); break;
+                case AppContainerSortColumn::AppContainerSid: keys[i] = GetSortKey(app.AppContainerSid()); break;
+                case AppContainerSortColumn::UserSid: keys[i] = GetSortKey(app.UserSid()); break;
+                default: break;
+                }
+            }
+
+            vector<uint32_t>& order = sortOrders[column];
+            order.resize(apps.size());
+            for (uint32_t i = 0; i < Size(); i++)
+            {
+                order[i] = i;
+            }
+            stable_sort(order.begin(), order.end(), [&](const uint32_t left, const uint32_t right) { return keys[left] < keys[right]; });
+
+            vector<bool>& ties = sortTies[column];
+            ties.assign(apps.size(), false);
+            for (uint32_t i = 1; i < Size(); i++)
+            {
+                ties[i] = keys[order[i]] == keys[order[i - 1]];
+            }
+        }
+    }
+
+    const vector<uint32_t> AppContainerSnapshot::GetSorted(const AppContainerSortColumn column, const bool ascending, const wstring_view filter) const
+    {
+        const wstring folded = FoldCase(filter);
+        const auto isMatch = [&](const uint32_t index)
+            {
+                return folded.empty()
+                    || searchNames[index].find(folded) != wstring::npos
+                    || searchPackages[index].find(folded) != wstring::npos;
+            };
+
+        vector<uint32_t> result;
+        result.reserve(apps.size());
+
+        if (column == AppContainerSortColumn::IsEnableLoop)
+        {
+            //Two passes over snapshot order give a stable partition in either direction.
+            for (const bool isEnableLoop : { !ascending, ascending })
+            {
+                for (uint32_t i = 0; i < Size(); i++)
+                {
+                    if (apps[i].IsEnableLoop() == isEnableLoop && isMatch(i))
+                    {
+                        result.push_back(i);
+                    }
+                }
+            }
+            return result;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(column);
+        if (index >= SortColumnCount) { throw hresult_invalid_argument(); }
+        const vector<uint32_t>& order = sortOrders[index];
+        const vector<bool>& ties = sortTies[index];
+
+        if (ascending)
+        {
+            for (const uint32_t i : order)
+            {
+                if (isMatch(i)) { result.push_back(i); }
+            }
+            return result;
+        }
+
+        //Walk the runs of equal keys from the last one back, each run front to back.
+        size_t end = order.size();
+        while (end > 0)
+        {
+            size_t start = end - 1;
+            while (start > 0 && ties[start])
+            {
+                start--;
+            }
+            for (size_t i = start; i < end; i++)
+            {
+                if (isMatch(order[i])) { result.push_back(order[i]); }
+            }
+            end = start;
+        }
+        return result;
+    }
+
+    const AppContainer AppContainerSnapshot::FindBySid(const wstring_view sid) const
+    {
+        const auto result = sidIndex.find(FoldCase(sid));
+        return result == sidIndex.end() ? nullptr : apps[result->second];
+    }
+
+    const vector<uint32_t>& AppContainerSnapshot::FindByPackageFamilyName(const wstring_view familyName) const
+    {
+        return Find(familyIndex, familyName);
+    }
+
+    const vector<uint32_t>& AppContainerSnapshot::FindByPublisherId(const wstring_view publisherId) const
+    {
+        return Find(publisherIndex, publisherId);
+    }
+
+    const vector<uint32_t>& AppContainerSnapshot::FindByUserSid(const wstring_view userSid) const
+    {
+        return Find(userIndex, userSid);
+    }
+
+    const AppContainer AppContainerSnapshot::FindByPath(const wstring_view path) const
+    {
+        const uint32_t owner = pathIndex.FindLongestPrefix(path);
+        return owner == PathTrie::NoOwner ? nullptr : apps[owner];
+    }
+
+    void AppContainerSnapshot::MergeFrom(const AppContainerSnapshot& previous, vector<LoopBack::Metadata::AppContainerChange>& changes)
+    {
+        baseSerial = previous.serial;
+        baseIndices.assign(apps.size(), NoIndex);
+
+        size_t left = 0;
+        size_t right = 0;
+        while (left < previous.keyOrder.size() || right < keyOrder.size())
+        {
+            const uint32_t oldIndex = left < previous.keyOrder.size() ? previous.keyOrder[left] : UINT32_MAX;
+            const uint32_t newIndex = right < keyOrder.size() ? keyOrder[right] : UINT32_MAX;
+            const int order = oldIndex == UINT32_MAX ? 1
+                : newIndex == UINT32_MAX ? -1
+                : previous.keys[oldIndex].compare(keys[newIndex]);
+
+            if (order < 0)
+            {
+                changes.push_back(make<implementation::AppContainerChange>(AppContainerChangeKind::Removed, AppContainerFields::All, previous.apps[oldIndex], nullptr));
+                left++;
+            }
+            else if (order > 0)
+            {
+                changes.push_back(make<implementation::AppContainerChange>(AppContainerChangeKind::Added, AppContainerFields::All, nullptr, apps[newIndex]));
+                right++;
+            }
+            else
+            {
+                const AppContainerFields fields = Compare(previous.apps[oldIndex], apps[newIndex]);
+                if (fields == AppContainerFields::None)
+                {
+                    apps[newIndex] = previous.apps[oldIndex];
+                    baseIndices[newIndex] = oldIndex;
+                }
+                else
+                {
+                    changes.push_back(make<implementation::AppContainerChange>(AppContainerChangeKind::Changed, fields, previous.apps[oldIndex], apps[newIndex]));
+                }
+                left++;
+                right++;
+            }
+        }
+    }
+
+    const uint64_t AppContainerSnapshot::Hash(const AppContainer& app, uint64_t& sidHash)
+    {
+        sidHash = ContentHash::OffsetBasis;
+        ContentHash::AddString(sidHash, app.AppContainerSid());
+        ContentHash::AddString(sidHash, app.UserSid());
+        sidHash = ContentHash::Mix(sidHash);
+
+        uint64_t hash = sidHash;
+        ContentHash::AddString(hash, app.DisplayName());
+        ContentHash::AddString(hash, app.Description());
+        ContentHash::AddString(hash, app.AppContainerName());
+        ContentHash::AddString(hash, app.PackageFullName());
+        ContentHash::AddString(hash, app.WorkingDirectory());
+        for (const IVector<hstring>& values : { app.Capabilities(), app.Binaries() })
+        {
+            if (values)
+            {
+                for (const hstring& value : values)
+                {
+                    ContentHash::AddString(hash, value);
+                }
+            }
+            ContentHash::EndList(hash);
+        }
+        return ContentHash::Mix(hash);
+    }
+
+    const AppContainerFields AppContainerSnapshot::Compare(const AppContainer& left, const AppContainer& right)
+    {
+        AppContainerFields fields = AppContainerFields::None;
+        if (left.IsEnableLoop() != right.IsEnableLoop()) { fields |= AppContainerFields::IsEnableLoop; }
+        if (left.DisplayName() != right.DisplayName()) { fields |= AppContainerFields::DisplayName; }
+        if (left.Description() != right.Description()) { fields |= AppContainerFields::Description; }
+        if (left.AppContainerName() != right.AppContainerName()) { fields |= AppContainerFields::AppContainerName; }
+        if (left.PackageFullName() != right.PackageFullName()) { fields |= AppContainerFields::PackageFullName; }
+        if (left.WorkingDirectory() != right.WorkingDirectory()) { fields |= AppContainerFields::WorkingDirectory; }
+        if (!SequenceEqual(left.Capabilities(), right.Capabilities())) { fields |= AppContainerFields::Capabilities; }
+        if (!SequenceEqual(left.Binaries(), right.Binaries())) { fields |= AppContainerFields::Binaries; }
+        return fields;
+    }
+
+    const bool AppContainerSnapshot::SequenceEqual(const IVector<hstring>& left, const IVector<hstring>& right)
+    {
+        const uint32_t size = left ? left.Size() : 0;
+        if (size != (right ? right.Size() : 0)) { return false; }
+        for (uint32_t i = 0; i < size; i++)
+        {
+            if (left.GetAt(i) != right.GetAt(i)) { return false; }
+        }
+        return true;
+    }
+
+    const uint64_t AppContainerSnapshot::NextSerial()
+    {
+        static atomic<uint64_t> last = 0;
+        return ++last;
+    }
+
+    const vector<uint32_t>& AppContainerSnapshot::Find(const unordered_map<wstring, vector<uint32_t>>& index, const wstring_view key)
+    {
+        static const vector<uint32_t> empty;
+        const auto result = index.find(FoldCase(key));
+        return result == index.end() ? empty : result->second;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "PathTrie.h"
+#include "StringHelpers.h"
+#include <winrt/LoopBack.Metadata.h>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+using namespace winrt;
+using namespace LoopBack::Metadata;
+using namespace Windows::Foundation::Collections;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // The parts of "Name_Version_Architecture_ResourceId_PublisherId".
+    struct PackageIdentity
+    {
+        std::wstring Name;
+        uint64_t Version = 0;
+        std::wstring Architecture;
+        std::wstring ResourceId;
+        std::wstring PublisherId;
+        std::wstring FamilyName;
+
+        static PackageIdentity Parse(const std::wstring_view packageFullName);
+
+    private:
+        static const uint64_t ParseVersion(const std::wstring_view version);
+    };
+
+    // The app containers of one enumeration together with lookup indexes over them.
+    // Keys are folded with FoldCase, so every lookup is case-insensitive.
+    struct AppContainerSnapshot
+    {
+        static constexpr uint32_t NoIndex = UINT32_MAX;
+
+        AppContainerSnapshot() : serial(NextSerial()) {}
+
+        void Append(const AppContainer& app);
+        void Preserve(const hstring& sid) { preservedSids.push_back(sid); }
+        void Seal();
+
+        const uint32_t Size() const { return static_cast<uint32_t>(apps.size()); }
+        const std::vector<AppContainer>& Apps() const { return apps; }
+        const AppContainer& GetAt(const uint32_t index) const { return apps[index]; }
+        const PackageIdentity& GetIdentity(const uint32_t index) const { return identities[index]; }
+
+        // Order-independent 64-bit hash of every container's SIDs, names, capabilities and
+        // exemption flag. The flags can change after commits, so their part is summed on demand.
+        const uint64_t ETag() const;
+
+        const AppContainer FindBySid(const std::wstring_view sid) const;
+        const std::vector<uint32_t>& FindByPackageFamilyName(const std::wstring_view familyName) const;
+        const std::vector<uint32_t>& FindByPublisherId(const std::wstring_view publisherId) const;
+        const std::vector<uint32_t>& FindByUserSid(const std::wstring_view userSid) const;
+        const AppContainer FindByPath(const std::wstring_view path) const;
+
+        // Filters containers with bitmap operations over the per-capability posting lists.
+        // Every SID in allOf is required, at least one in anyOf when it is not empty,
+        // none in noneOf, and isEnableLoop, when set, must match the exemption flag.
+        const std::vector<uint32_t> QueryByCapabilities(
+            const std::vector<std::wstring_view>& allOf,
+            const std::vector<std::wstring_view>& anyOf,
+            const std::vector<std::wstring_view>& noneOf,
+            const std::optional<bool> isEnableLoop) const;
+        const bool HasCapability(const uint32_t index, const std::wstring_view capabilitySid) const;
+
+        // Walks the sort order of a column computed by Seal, keeping only containers whose
+        // display name or package full name contains filter. Equal keys keep snapshot order
+        // in both directions.
+        const std::vector<uint32_t> GetSorted(const AppContainerSortColumn column, const bool ascending, const std::wstring_view filter) const;
+
+        // Exempted SIDs of containers that were left out of a user scoped snapshot.
+        // Commits made from the snapshot must carry them over unchanged.
+        const std::vector<hstring>& PreservedSids() const { return preservedSids; }
+
+        // Produces the edit script that turns previous into this snapshot with a sorted merge
+        // over the container keys. Unchanged containers keep the instances from previous.
+        void MergeFrom(const AppContainerSnapshot& previous, std::vector<LoopBack::Metadata::AppContainerChange>& changes);
+
+        // Identifies the snapshot within the process, so results computed from one can be told apart.
+        const uint64_t Serial() const { return serial; }
+
+        // The serial of the snapshot MergeFrom last ran against, or zero, and the index in it of
+        // every container the merge found unchanged. Added and changed containers get NoIndex.
+        const uint64_t BaseSerial() const { return baseSerial; }
+        const uint32_t GetBaseIndex(const uint32_t index) const { return baseIndices.empty() ? NoIndex : baseIndices[index]; }
+
+    private:
+        uint64_t serial;
+        uint64_t baseSerial = 0;
+        std::vector<uint32_t> baseIndices;
+        std::vector<AppContainer> apps;
+        std::vector<PackageIdentity> identities;
+        std::vector<std::wstring> keys;
+        std::vector<uint32_t> keyOrder;
+        std::unordered_map<std::wstring, uint32_t> sidIndex;
+        std::unordered_map<std::wstring, std::vector<uint32_t>> familyIndex;
+        std::unordered_map<std::wstring, std::vector<uint32_t>> publisherIndex;
+        std::unordered_map<std::wstring, std::vector<uint32_t>> userIndex;
+        std::vector<hstring> preservedSids;
+
+        // Every distinct capability SID gets a dense bit index. Containers share one
+        // capabilityWords wide bitset per distinct capability set, and every capability
+        // has a posting bitmap of containerWords words over the containers holding it.
+        std::unordered_map<std::wstring, uint32_t> capabilityIds;
+        std::vector<std::vector<uint32_t>> pendingCapabilities;
+        std::vector<uint32_t> capabilitySetIds;
+        std::vector<uint64_t> capabilitySets;
+        std::vector<uint64_t> capabilityPostings;
+        size_t capabilityWords = 0;
+        size_t containerWords = 0;
+
+        uint64_t contentHash = 0;
+        std::vector<uint64_t> sidHashes;
+
+        void BuildCapabilityIndex();
+
+        // Stable ascending order of every string column, with a flag on each position whose
+        // key equals the one before it. IsEnableLoop changes after commits and is ordered on demand.
+        static constexpr uint32_t SortColumnCount = 7;
+        std::vector<uint32_t> sortOrders[SortColumnCount];
+        std::vector<bool> sortTies[SortColumnCount];
+        std::vector<std::wstring> searchNames;
+        std::vector<std::wstring> searchPackages;
+
+        void BuildSortOrders();
+        const uint64_t* GetPosting(const std::wstring_view capabilitySid) const;
+        PathTrie pathIndex;
+
+        static const uint64_t NextSerial();
+        static const uint64_t Hash(const AppContainer& app, uint64_t& sidHash);
+        static const AppContainerFields Compare(const AppContainer& left, const AppContainer& right);
+        static const bool SequenceEqual(const IVector<hstring>& left, const IVector<hstring>& right);
+        static const std::vector<uint32_t>& Find(const std::unordered_map<std::wstring, std::vector<uint32_t>>& index, const std::wstring_view key);
+    };
+}
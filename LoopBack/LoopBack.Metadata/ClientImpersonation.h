@@ -0,0 +1,43 @@
+#pragma once
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Impersonates the COM client of the current call until the object goes out of scope,
+    // so a path given by a client is opened with its access rather than the server's.
+    // A call made in process, or work the server does on its own, has no call context and
+    // already runs as the caller.
+    struct ClientImpersonation
+    {
+        ClientImpersonation()
+        {
+            if (!HasCallContext()) { return; }
+            check_hresult(CoImpersonateClient());
+            isImpersonating = true;
+        }
+
+        // Whether the current thread is serving a COM call from a client. Outside of a call, and
+        // on a thread without COM, there is nobody but this process to act for.
+        static const bool HasCallContext()
+        {
+            com_ptr<IServerSecurity> security;
+            const HRESULT result = CoGetCallContext(guid_of<IServerSecurity>(), security.put_void());
+            if (result == RPC_E_CALL_COMPLETE || result == CO_E_NOTINITIALIZED) { return false; }
+            check_hresult(result);
+            return true;
+        }
+
+        ~ClientImpersonation()
+        {
+            if (isImpersonating)
+            {
+                CoRevertToSelf();
+            }
+        }
+
+        ClientImpersonation(const ClientImpersonation&) = delete;
+        ClientImpersonation& operator=(const ClientImpersonation&) = delete;
+
+    private:
+        bool isImpersonating = false;
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Sorts every SID of an exemption config list into kept, orphaned or duplicate in one
+    // hash-join pass. A SID seen before is a duplicate, one isLive rejects is orphaned and
+    // any other is kept, in list order. Lists that are not needed may be null.
+    template <typename TString, typename TList, typename TIsLive>
+    void AuditSidList(const TList& configList, const size_t size, TIsLive&& isLive, std::vector<TString>* keptList, std::vector<TString>* orphanedList, std::vector<TString>* duplicateList)
+    {
+        std::unordered_set<TString> seenSet;
+        seenSet.reserve(size);
+        for (const TString& sid : configList)
+        {
+            if (!seenSet.insert(sid).second)
+            {
+                if (duplicateList) { duplicateList->push_back(sid); }
+            }
+            else if (!isLive(sid))
+            {
+                if (orphanedList) { orphanedList->push_back(sid); }
+            }
+            else if (keptList)
+            {
+                keptList->push_back(sid);
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Steps of the snapshot ETag. Fields are hashed with FNV-1a, each followed by a separator
+    // so fields cannot run together, and a container's hash is finalized with Mix. Snapshots
+    // sum the container hashes, so the result does not depend on enumeration order.
+    struct ContentHash
+    {
+        static constexpr uint64_t OffsetBasis = 0xCBF29CE484222325ull;
+
+        // splitmix64 finalizer, spreads a hash over all 64 bits so that sums do not collide easily.
+        static const uint64_t Mix(uint64_t value)
+        {
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            return value ^ (value >> 31);
+        }
+
+        // FNV-1a over the UTF-16 code units, followed by the field separator.
+        static void AddString(uint64_t& hash, const std::wstring_view value)
+        {
+            for (const wchar_t c : value)
+            {
+                hash = (hash ^ static_cast<uint64_t>(c)) * Prime;
+            }
+            hash = (hash ^ 0xFFFFull) * Prime;
+        }
+
+        // Ends a list of strings, so items cannot move between adjacent lists.
+        static void EndList(uint64_t& hash)
+        {
+            hash = (hash ^ 0xFFFEull) * Prime;
+        }
+
+    private:
+        static constexpr uint64_t Prime = 0x100000001B3ull;
+    };
+}
@@ -0,0 +1,3 @@
+#include "pch.h"
+#include "ExemptionAuditReport.h"
+#include "ExemptionAuditReport.g.cpp"
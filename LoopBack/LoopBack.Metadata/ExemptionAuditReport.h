@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ExemptionAuditReport.g.h"
+
+using namespace winrt;
+using namespace Windows::Foundation::Collections;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    struct ExemptionAuditReport : ExemptionAuditReportT<ExemptionAuditReport>
+    {
+        ExemptionAuditReport(
+            const uint32_t configCount,
+            const IVectorView<hstring>& orphanedSids,
+            const IVectorView<hstring>& duplicateSids)
+            : configCount(configCount), orphanedSids(orphanedSids), duplicateSids(duplicateSids) {}
+
+        const uint32_t ConfigCount() const { return configCount; }
+        IVectorView<hstring> OrphanedSids() const { return orphanedSids; }
+        IVectorView<hstring> DuplicateSids() const { return duplicateSids; }
+
+    private:
+        uint32_t configCount;
+        IVectorView<hstring> orphanedSids;
+        IVectorView<hstring> duplicateSids;
+    };
+}
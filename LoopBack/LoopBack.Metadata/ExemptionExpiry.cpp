@@ -0,0 +1,236 @@
+#include "pch.h"
+#include "ExemptionExpiry.h"
+#include "LoopUtil.h"
+#include "ServerFactory.h"
+#include "StorageHelpers.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    ExemptionExpiry& ExemptionExpiry::Current()
+    {
+        static ExemptionExpiry expiry;
+        return expiry;
+    }
+
+    ExemptionExpiry::ExemptionExpiry() : wheel(Now()), path(GetStateFilePath(L"Exemptions.expiry"))
+    {
+        isElevated = Factory::IsRunAsAdministrator();
+        timer = CreateThreadpoolTimer(OnTick, this, nullptr);
+        if (!timer) { throw_last_error(); }
+
+        const lock_guard<mutex> guard(lock);
+        Load();
+        Track(0);
+    }
+
+    void ExemptionExpiry::Schedule(const hstring& stringSid, const Windows::Foundation::TimeSpan& duration)
+    {
+        const lock_guard<mutex> guard(lock);
+        const size_t previousSize = PendingSize();
+        //Round up so an exemption never ends before the requested duration.
+        const uint64_t lifetime = static_cast<uint64_t>(max<int64_t>(ceil<seconds>(duration).count(), 1));
+        const wstring key(stringSid);
+        wheel.Schedule(key, Now() + lifetime);
+        inFlight.erase(key);
+        retries.erase(key);
+        Save();
+        Track(previousSize);
+    }
+
+    void ExemptionExpiry::Cancel(const hstring& stringSid)
+    {
+        const lock_guard<mutex> guard(lock);
+        const size_t previousSize = PendingSize();
+        const wstring key(stringSid);
+        retries.erase(key);
+        const bool isScheduled = wheel.Cancel(key);
+        //An entry being committed is dropped too, so the commit does not put it back on failure.
+        const bool isCommitting = inFlight.erase(key) != 0;
+        if (isScheduled || isCommitting)
+        {
+            Save();
+            Track(previousSize);
+        }
+    }
+
+    const optional<Windows::Foundation::DateTime> ExemptionExpiry::GetExpiry(const hstring& stringSid)
+    {
+        const lock_guard<mutex> guard(lock);
+        const wstring key(stringSid);
+        uint64_t deadline = 0;
+        if (const auto item = inFlight.find(key); item != inFlight.end())
+        {
+            deadline = item->second.Deadline;
+        }
+        else if (const auto item = wheel.Deadlines().find(key); item != wheel.Deadlines().end())
+        {
+            deadline = item->second;
+        }
+        else
+        {
+            return nullopt;
+        }
+        return Windows::Foundation::DateTime(duration_cast<Windows::Foundation::TimeSpan>(seconds(deadline)));
+    }
+
+    const uint64_t ExemptionExpiry::Now()
+    {
+        return static_cast<uint64_t>(duration_cast<seconds>(winrt::clock::now().time_since_epoch()).count());
+    }
+
+    void CALLBACK ExemptionExpiry::OnTick(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER)
+    {
+        static_cast<ExemptionExpiry*>(context)->Tick();
+    }
+
+    void ExemptionExpiry::Tick()
+    {
+        vector<hstring> expired;
+        {
+            const lock_guard<mutex> guard(lock);
+            const uint64_t now = Now();
+            for (wstring& stringSid : wheel.Advance(now))
+            {
+                //The entry is only dropped from the table once the commit removing it succeeded.
+                const auto retry = retries.find(stringSid);
+                const uint32_t attempts = retry == retries.end() ? 0 : retry->second;
+                if (retry != retries.end()) { retries.erase(retry); }
+                expired.emplace_back(stringSid);
+                inFlight.insert_or_assign(move(stringSid), InFlight{ now, attempts });
+            }
+            if (expired.empty()) { return; }
+        }
+
+        //Everything that expired within the tick goes out in one commit.
+        HRESULT result = E_FAIL;
+        try
+        {
+            result = make_self<LoopUtil>()->RemoveExpiredLookbacks(expired);
+        }
+        catch (...)
+        {
+            result = to_hresult();
+        }
+
+        const lock_guard<mutex> guard(lock);
+        const size_t previousSize = PendingSize();
+        const uint64_t now = Now();
+        for (const hstring& stringSid : expired)
+        {
+            //Entries cancelled or scheduled again while the commit ran are no longer ours.
+            const auto item = inFlight.find(wstring(stringSid));
+            if (item == inFlight.end()) { continue; }
+            if (FAILED(result))
+            {
+                const uint32_t attempts = item->second.Attempts + 1;
+                wheel.Schedule(item->first, now + (1ull << min(attempts, MaxRetryShift)));
+                retries.insert_or_assign(item->first, attempts);
+            }
+            inFlight.erase(item);
+        }
+        try
+        {
+            Save();
+        }
+        catch (...)
+        {
+            //The table is written again with the next change, and a stale one only repeats a removal.
+        }
+        Track(previousSize);
+    }
+
+    void ExemptionExpiry::Track(const size_t previousSize)
+    {
+        //The timer runs and the server stays alive only while expiries are pending.
+        if (!isElevated) { return; }
+        const size_t size = PendingSize();
+        if (!previousSize && size)
+        {
+            CoAddRefServerProcess();
+            LARGE_INTEGER due{};
+            due.QuadPart = -10000000LL;
+            FILETIME dueTime{ due.LowPart, static_cast<DWORD>(due.HighPart) };
+            SetThreadpoolTimer(timer, &dueTime, 1000, 100);
+        }
+        else if (previousSize && !size)
+        {
+            SetThreadpoolTimer(timer, nullptr, 0, 0);
+            if (CoReleaseServerProcess() == 0)
+            {
+                _releaseNotifier();
+            }
+        }
+    }
+
+    void ExemptionExpiry::Load()
+    {
+        const file_handle file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!file) { return; }
+
+        LARGE_INTEGER size{};
+        check_bool(GetFileSizeEx(file.get(), &size));
+        vector<uint8_t> buffer(static_cast<size_t>(size.QuadPart));
+        DWORD read = 0;
+        check_bool(ReadFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr));
+        buffer.resize(read);
+
+        uint32_t magic = 0;
+        if (buffer.size() < sizeof(magic)) { return; }
+        memcpy(&magic, buffer.data(), sizeof(magic));
+        if (magic != Magic) { return; }
+
+        //Each entry is the deadline in seconds, the SID length and the SID characters.
+        size_t offset = sizeof(magic);
+        while (offset + sizeof(uint64_t) + sizeof(uint16_t) <= buffer.size())
+        {
+            uint64_t deadline;
+            uint16_t length;
+            memcpy(&deadline, buffer.data() + offset, sizeof(deadline));
+            memcpy(&length, buffer.data() + offset + sizeof(deadline), sizeof(length));
+            offset += sizeof(deadline) + sizeof(length);
+            if (offset + length * sizeof(wchar_t) > buffer.size()) { break; }
+            wstring stringSid(length, L'\0');
+            memcpy(stringSid.data(), buffer.data() + offset, length * sizeof(wchar_t));
+            offset += length * sizeof(wchar_t);
+            //Entries that expired while the server was down fire on the first tick.
+            wheel.Schedule(stringSid, deadline);
+        }
+    }
+
+    void ExemptionExpiry::Save() const
+    {
+        vector<uint8_t> buffer(sizeof(Magic));
+        memcpy(buffer.data(), &Magic, sizeof(Magic));
+        const auto writeEntry = [&](const wstring& stringSid, const uint64_t deadline)
+            {
+                const uint16_t length = static_cast<uint16_t>(stringSid.size());
+                const size_t offset = buffer.size();
+                buffer.resize(offset + sizeof(deadline) + sizeof(length) + length * sizeof(wchar_t));
+                memcpy(buffer.data() + offset, &deadline, sizeof(deadline));
+                memcpy(buffer.data() + offset + sizeof(deadline), &length, sizeof(length));
+                memcpy(buffer.data() + offset + sizeof(deadline) + sizeof(length), stringSid.data(), length * sizeof(wchar_t));
+            };
+        for (const auto& [stringSid, deadline] : wheel.Deadlines())
+        {
+            writeEntry(stringSid, deadline);
+        }
+        //Entries being committed are kept with the time they fired, so a crash fires them again.
+        for (const auto& [stringSid, item] : inFlight)
+        {
+            writeEntry(stringSid, item.Deadline);
+        }
+
+        //Write a sibling file and swap it in, so a crash never leaves a torn table behind.
+        const wstring temporary = path + L".tmp";
+        {
+            const file_handle file(CreateFile(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+            if (!file) { throw_last_error(); }
+            DWORD written = 0;
+            check_bool(WriteFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &written, nullptr));
+        }
+        check_bool(MoveFileEx(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "TimerWheel.h"
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Removes temporary exemptions once their lifetime is over. Deadlines are kept in a
+    // one second TimerWheel, every tick removes whatever expired in a single commit, and
+    // the pending table is mirrored to a state file so expiries survive a server restart.
+    // An expired entry stays in the table until its commit succeeds; a failed commit puts
+    // it back on the wheel with an exponential backoff. The elevated server is kept alive
+    // while any expiry is pending; other processes only read the table, since they could
+    // not commit the removals.
+    struct ExemptionExpiry
+    {
+        static ExemptionExpiry& Current();
+
+        void Schedule(const hstring& stringSid, const Windows::Foundation::TimeSpan& duration);
+        void Cancel(const hstring& stringSid);
+        const std::optional<Windows::Foundation::DateTime> GetExpiry(const hstring& stringSid);
+
+    private:
+        static constexpr uint32_t Magic = 0x31584C4C; // LLX1
+        // Retries wait 2^n seconds after the n-th failure, up to 2^MaxRetryShift.
+        static constexpr uint32_t MaxRetryShift = 8;
+
+        struct InFlight
+        {
+            uint64_t Deadline;
+            uint32_t Attempts;
+        };
+
+        std::mutex lock;
+        TimerWheel wheel;
+        // Entries that fired and are being committed, with the time they fired.
+        std::unordered_map<std::wstring, InFlight> inFlight;
+        // Failed attempts of entries that were put back on the wheel.
+        std::unordered_map<std::wstring, uint32_t> retries;
+        PTP_TIMER timer = nullptr;
+        std::wstring path;
+        bool isElevated = false;
+
+        ExemptionExpiry();
+
+        static const uint64_t Now();
+        static void CALLBACK OnTick(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+        void Tick();
+        void Load();
+        void Save() const;
+        const size_t PendingSize() const { return wheel.Size() + inFlight.size(); }
+        void Track(const size_t previousSize);
+    };
+}
@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "ExemptionJournal.h"
+#include "StorageHelpers.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    namespace
+    {
+        //Holds an exclusive lock on a byte past any real end of the journal while records
+        //are appended, so appends from several processes never interleave.
+        struct JournalLock
+        {
+            explicit JournalLock(const HANDLE file) : file(file)
+            {
+                OVERLAPPED overlapped = GetOverlapped();
+                check_bool(LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped));
+            }
+
+            ~JournalLock()
+            {
+                OVERLAPPED overlapped = GetOverlapped();
+                UnlockFileEx(file, 0, 1, 0, &overlapped);
+            }
+
+        private:
+            const HANDLE file;
+
+            static OVERLAPPED GetOverlapped()
+            {
+                OVERLAPPED overlapped{};
+                overlapped.Offset = MAXDWORD;
+                overlapped.OffsetHigh = MAXLONG;
+                return overlapped;
+            }
+        };
+    }
+
+    template <typename TCallback>
+    void ExemptionJournal::ForEachRecord(const vector<uint8_t>& buffer, TCallback&& callback)
+    {
+        size_t offset = 0;
+        while (offset + sizeof(Record) <= buffer.size())
+        {
+            Record record;
+            memcpy(&record, buffer.data() + offset, sizeof(Record));
+            const size_t end = offset + sizeof(Record) + record.SidLength;
+            //A torn write at the end of the file is ignored.
+            if (end > buffer.size()) { break; }
+            const string_view sid(reinterpret_cast<const char*>(buffer.data() + offset + sizeof(Record)), record.SidLength);
+            if (!callback(record, sid, offset)) { break; }
+            offset = end;
+        }
+    }
+
+    ExemptionJournal& ExemptionJournal::Current()
+    {
+        static ExemptionJournal journal;
+        return journal;
+    }
+
+    ExemptionJournal::ExemptionJournal()
+    {
+        file.attach(CreateFile(
+            GetStateFilePath(L"Exemptions.journal").c_str(),
+            GENERIC_READ | FILE_APPEND_DATA,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr,
+            OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (!file) { throw_last_error(); }
+
+        const JournalLock fileLock(file.get());
+        LARGE_INTEGER size{};
+        check_bool(GetFileSizeEx(file.get(), &size));
+        fileSize = static_cast<uint64_t>(size.QuadPart);
+        if (fileSize < sizeof(Magic))
+        {
+            vector<uint8_t> header(sizeof(Magic));
+            memcpy(header.data(), &Magic, sizeof(Magic));
+            Write(header);
+        }
+        Refresh();
+    }
+
+    void ExemptionJournal::Append(const DWORD count, const SID_AND_ATTRIBUTES* sids)
+    {
+        const lock_guard<mutex> guard(lock);
+        const JournalLock fileLock(file.get());
+        Refresh();
+
+        unordered_set<string> next = GetSids(count, sids);
+        const int64_t timestamp = GetTimestamp();
+        const uint32_t current = sequence + 1;
+
+        vector<uint8_t> buffer;
+        for (const string& sid : next)
+        {
+            if (!list.contains(sid))
+            {
+                AppendRecord(buffer, RecordKind::Add, current, timestamp, sid);
+            }
+        }
+        for (const string& sid : list)
+        {
+            if (!next.contains(sid))
+            {
+                AppendRecord(buffer, RecordKind::Remove, current, timestamp, sid);
+            }
+        }
+
+        //Numbering stays dense, so every sequence up to Size can be rolled back to.
+        if (buffer.empty()) { return; }
+
+        uint64_t checkpoint = 0;
+        if (current % CheckpointInterval == 0)
+        {
+            checkpoint = fileSize + buffer.size();
+            AppendRecord(buffer, RecordKind::Checkpoint, current, timestamp, {});
+            for (const string& sid : next)
+            {
+                AppendRecord(buffer, RecordKind::CheckpointEntry, current, timestamp, sid);
+            }
+        }
+
+        Write(buffer);
+        sequence = current;
+        list = move(next);
+        if (checkpoint)
+        {
+            checkpoints.emplace_back(current, checkpoint);
+        }
+    }
+
+    const bool ExemptionJournal::HasBaseline()
+    {
+        const lock_guard<mutex> guard(lock);
+        Refresh();
+        return !checkpoints.empty() && checkpoints.front().first == 0;
+    }
+
+    void ExemptionJournal::SetBaseline(const DWORD count, const SID_AND_ATTRIBUTES* sids)
+    {
+        const lock_guard<mutex> guard(lock);
+        const JournalLock fileLock(file.get());
+        Refresh();
+        //Another process may have committed or recorded its baseline since the caller checked.
+        if (sequence > 0 || !checkpoints.empty()) { return; }
+
+        unordered_set<string> baseline = GetSids(count, sids);
+        const int64_t timestamp = GetTimestamp();
+        const uint64_t checkpoint = fileSize;
+        vector<uint8_t> buffer;
+        AppendRecord(buffer, RecordKind::Checkpoint, 0, timestamp, {});
+        for (const string& sid : baseline)
+        {
+            AppendRecord(buffer, RecordKind::CheckpointEntry, 0, timestamp, sid);
+        }
+
+        Write(buffer);
+        list = move(baseline);
+        checkpoints.emplace_back(0, checkpoint);
+    }
+
+    const uint32_t ExemptionJournal::Size()
+    {
+        const lock_guard<mutex> guard(lock);
+        Refresh();
+        return sequence;
+    }
+
+    vector<string> ExemptionJournal::GetListAt(const uint32_t target)
+    {
+        const lock_guard<mutex> guard(lock);
+        Refresh();
+
+        //Start from the last checkpoint at or before the target instead of the beginning.
+        uint64_t offset = sizeof(Magic);
+        const auto checkpoint = upper_bound(checkpoints.begin(), checkpoints.end(), target,
+            [](const uint32_t value, const pair<uint32_t, uint64_t>& item) { return value < item.first; });
+        if (checkpoint != checkpoints.begin())
+        {
+            offset = prev(checkpoint)->second;
+        }
+
+        unordered_set<string> result;
+        ForEachRecord(Read(offset), [&](const Record& record, const string_view sid, size_t)
+            {
+                if (record.Sequence > target) { return false; }
+                switch (record.Kind)
+                {
+                case RecordKind::Add:
+                case RecordKind::CheckpointEntry:
+                    result.emplace(sid);
+                    break;
+                case RecordKind::Remove:
+                    result.erase(string(sid));
+                    break;
+                case RecordKind::Checkpoint:
+                    result.clear();
+                    break;
+                default:
+                    break;
+                }
+                return true;
+            });
+
+        return { result.begin(), result.end() };
+    }
+
+    vector<ExemptionJournalEntry> ExemptionJournal::GetHistory(const PSID sid)
+    {
+        const lock_guard<mutex> guard(lock);
+        Refresh();
+
+        vector<ExemptionJournalEntry> result;
+        if (!sid || !IsValidSid(sid)) { return result; }
+
+        const string_view key(static_cast<const char*>(sid), GetLengthSid(sid));
+        ForEachRecord(Read(sizeof(Magic)), [&](const Record& record, const string_view value, size_t)
+            {
+                if ((record.Kind == RecordKind::Add || record.Kind == RecordKind::Remove) && value == key)
+                {
+                    result.push_back({ record.Sequence, record.Timestamp, record.Kind == RecordKind::Add });
+                }
+                return true;
+            });
+
+        return result;
+    }
+
+    void ExemptionJournal::Refresh()
+    {
+        LARGE_INTEGER size{};
+        check_bool(GetFileSizeEx(file.get(), &size));
+        fileSize = static_cast<uint64_t>(size.QuadPart);
+        if (fileSize <= loadedSize) { return; }
+
+        //Only whole records are taken, a record still being written is read again next time.
+        const uint64_t start = loadedSize;
+        ForEachRecord(Read(start), [&](const Record& record, const string_view sid, const size_t offset)
+            {
+                switch (record.Kind)
+                {
+                case RecordKind::Add:
+                    list.emplace(sid);
+                    break;
+                case RecordKind::Remove:
+                    list.erase(string(sid));
+                    break;
+                case RecordKind::Checkpoint:
+                    //A checkpoint repeats the list after its commit, or holds the baseline.
+                    list.clear();
+                    checkpoints.emplace_back(record.Sequence, start + offset);
+                    break;
+                case RecordKind::CheckpointEntry:
+                    list.emplace(sid);
+                    break;
+                default:
+                    break;
+                }
+                sequence = max(sequence, record.Sequence);
+                loadedSize = start + offset + sizeof(Record) + sid.size();
+                return true;
+            });
+    }
+
+    unordered_set<string> ExemptionJournal::GetSids(const DWORD count, const SID_AND_ATTRIBUTES* sids)
+    {
+        unordered_set<string> result;
+        result.reserve(count);
+        for (DWORD i = 0; i < count; i++)
+        {
+            if (sids[i].Sid && IsValidSid(sids[i].Sid))
+            {
+                result.emplace(static_cast<const char*>(sids[i].Sid), GetLengthSid(sids[i].Sid));
+            }
+        }
+        return result;
+    }
+
+    const int64_t ExemptionJournal::GetTimestamp()
+    {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        return (static_cast<int64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+    }
+
+    vector<uint8_t> ExemptionJournal::Read(const uint64_t offset)
+    {
+        vector<uint8_t> buffer(offset < fileSize ? static_cast<size_t>(fileSize - offset) : 0);
+        size_t position = 0;
+        while (position < buffer.size())
+        {
+            OVERLAPPED overlapped{};
+            const uint64_t current = offset + position;
+            overlapped.Offset = static_cast<DWORD>(current);
+            overlapped.OffsetHigh = static_cast<DWORD>(current >> 32);
+            DWORD read = 0;
+            const DWORD chunk = static_cast<DWORD>(min<size_t>(buffer.size() - position, 1 << 24));
+            if (!ReadFile(file.get(), buffer.data() + position, chunk, &read, &overlapped) || read == 0)
+            {
+                break;
+            }
+            position += read;
+        }
+        buffer.resize(position);
+        return buffer;
+    }
+
+    void ExemptionJournal::Write(const vector<uint8_t>& buffer)
+    {
+        if (buffer.empty()) { return; }
+        DWORD written = 0;
+        check_bool(WriteFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &written, nullptr));
+        fileSize += written;
+        loadedSize = fileSize;
+    }
+
+    void ExemptionJournal::AppendRecord(vector<uint8_t>& buffer, const RecordKind kind, const uint32_t sequence, const int64_t timestamp, const string_view sid)
+    {
+        const Record record{ kind, static_cast<uint8_t>(sid.size()), 0, sequence, timestamp };
+        const size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(Record) + sid.size());
+        memcpy(buffer.data() + offset, &record, sizeof(Record));
+        memcpy(buffer.data() + offset + sizeof(Record), sid.data(), sid.size());
+    }
+}
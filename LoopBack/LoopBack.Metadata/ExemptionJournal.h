@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    struct ExemptionJournalEntry
+    {
+        uint32_t Sequence;
+        int64_t Timestamp;
+        bool IsAdded;
+    };
+
+    // Append-only binary log of every exemption list committed by this process.
+    // Each commit is stored as the SIDs it added and removed, and the full list is
+    // written as a checkpoint every CheckpointInterval commits, so the list after any
+    // commit can be rebuilt from the nearest checkpoint plus the deltas after it.
+    // The file is shared with the other LoopBack processes of the user, so records they
+    // appended are read in before every access and appends hold a lock on the file.
+    // A commit that leaves the list unchanged is not recorded and takes no sequence.
+    // The list found before the first commit is kept as a checkpoint with sequence zero.
+    struct ExemptionJournal
+    {
+        static constexpr uint32_t CheckpointInterval = 64;
+
+        static ExemptionJournal& Current();
+
+        void Append(const DWORD count, const SID_AND_ATTRIBUTES* sids);
+        // Whether sequence zero holds the list from before the first commit. Journals started
+        // before baselines were recorded have none.
+        const bool HasBaseline();
+        // Records sids as sequence zero, unless a commit or a baseline was recorded already.
+        void SetBaseline(const DWORD count, const SID_AND_ATTRIBUTES* sids);
+        const uint32_t Size();
+        std::vector<std::string> GetListAt(const uint32_t sequence);
+        std::vector<ExemptionJournalEntry> GetHistory(const PSID sid);
+
+    private:
+        enum class RecordKind : uint8_t
+        {
+            Add = 1,
+            Remove,
+            Checkpoint,
+            CheckpointEntry
+        };
+
+        struct Record
+        {
+            RecordKind Kind;
+            uint8_t SidLength;
+            uint16_t Reserved;
+            uint32_t Sequence;
+            int64_t Timestamp;
+        };
+
+        static constexpr uint32_t Magic = 0x314A424C; // LBJ1
+
+        std::mutex lock;
+        file_handle file;
+        uint64_t fileSize = 0;
+        uint64_t loadedSize = sizeof(Magic);
+        uint32_t sequence = 0;
+        std::unordered_set<std::string> list;
+        std::vector<std::pair<uint32_t, uint64_t>> checkpoints;
+
+        ExemptionJournal();
+
+        void Refresh();
+        static std::unordered_set<std::string> GetSids(const DWORD count, const SID_AND_ATTRIBUTES* sids);
+        static const int64_t GetTimestamp();
+        std::vector<uint8_t> Read(const uint64_t offset);
+        void Write(const std::vector<uint8_t>& buffer);
+
+        template <typename TCallback>
+        static void ForEachRecord(const std::vector<uint8_t>& buffer, TCallback&& callback);
+        static void AppendRecord(std::vector<uint8_t>& buffer, const RecordKind kind, const uint32_t sequence, const int64_t timestamp, const std::string_view sid);
+    };
+}
@@ -0,0 +1,19 @@
+#include "pch.h"
+#include "ExemptionRule.h"
+#include "ExemptionRule.g.cpp"
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    hstring ExemptionRule::ToString() const
+    {
+        switch (kind)
+        {
+        case ExemptionRuleKind::Capability:
+            return L"Capability: " + pattern;
+        case ExemptionRuleKind::WorkingDirectory:
+            return L"WorkingDirectory: " + pattern;
+        default:
+            return L"PackageFamilyName: " + pattern;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ExemptionRule.g.h"
+
+using namespace winrt;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    struct ExemptionRule : ExemptionRuleT<ExemptionRule>
+    {
+        ExemptionRule() = default;
+        ExemptionRule(const ExemptionRuleKind kind, const hstring& pattern) : kind(kind), pattern(pattern) {}
+
+        const ExemptionRuleKind Kind() const { return kind; }
+        hstring Pattern() const { return pattern; }
+
+        void Kind(const ExemptionRuleKind value) { kind = value; }
+        void Pattern(const hstring& value) { pattern = value; }
+
+        hstring ToString() const;
+
+    private:
+        ExemptionRuleKind kind = ExemptionRuleKind::PackageFamilyName;
+        hstring pattern = L"";
+    };
+}
+
+namespace winrt::LoopBack::Metadata::factory_implementation
+{
+    struct ExemptionRule : ExemptionRuleT<ExemptionRule, implementation::ExemptionRule>
+    {
+    };
+}
@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "ExemptionRuleEngine.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    void ExemptionRuleEngine::Compile(const ExemptionRuleList& rules)
+    {
+        // Cached results stay valid as long as the rules do not change.
+        if (rules == source) { return; }
+
+        source = rules;
+        familyNames.clear();
+        familyPatterns.Clear();
+        capabilitySids.clear();
+        workingDirectories = PathTrie();
+        hasWorkingDirectories = false;
+        evaluatedSerial = 0;
+        results.clear();
+
+        for (const auto& [kind, pattern] : source)
+        {
+            switch (kind)
+            {
+            case ExemptionRuleKind::PackageFamilyName:
+                if (pattern.find_first_of(L"*?") == wstring::npos)
+                {
+                    familyNames.push_back(pattern);
+                }
+                else
+                {
+                    familyPatterns.Add(FoldCase(pattern));
+                }
+                break;
+            case ExemptionRuleKind::Capability:
+                AddCapability(pattern);
+                break;
+            case ExemptionRuleKind::WorkingDirectory:
+                //The trie matches whole path segments, so "C:\App" does not cover "C:\Apps".
+                workingDirectories.Insert(pattern, 0);
+                hasWorkingDirectories = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    const vector<uint32_t> ExemptionRuleEngine::Evaluate(const AppContainerSnapshot& snapshot)
+    {
+        if (snapshot.Serial() != evaluatedSerial)
+        {
+            //Containers MergeFrom found unchanged since the last evaluation keep their result.
+            const bool isIncremental = evaluatedSerial != 0 && snapshot.BaseSerial() == evaluatedSerial;
+            vector<bool> matched(snapshot.Size(), false);
+            vector<uint32_t> dirty;
+            for (uint32_t i = 0; i < snapshot.Size(); i++)
+            {
+                const uint32_t baseIndex = isIncremental ? snapshot.GetBaseIndex(i) : AppContainerSnapshot::NoIndex;
+                if (baseIndex == AppContainerSnapshot::NoIndex)
+                {
+                    dirty.push_back(i);
+                }
+                else
+                {
+                    matched[i] = results[baseIndex];
+                }
+            }
+
+            if (!dirty.empty())
+            {
+                Match(snapshot, dirty, matched);
+            }
+            results = move(matched);
+            evaluatedSerial = snapshot.Serial();
+        }
+
+        vector<uint32_t> indexes;
+        for (uint32_t i = 0; i < results.size(); i++)
+        {
+            if (results[i]) { indexes.push_back(i); }
+        }
+        return indexes;
+    }
+
+    void ExemptionRuleEngine::Match(const AppContainerSnapshot& snapshot, const vector<uint32_t>& dirty, vector<bool>& matched) const
+    {
+        //Index lookups may also mark clean containers, which carried the same result over anyway.
+        for (const wstring& familyName : familyNames)
+        {
+            for (const uint32_t index : snapshot.FindByPackageFamilyName(familyName))
+            {
+                matched[index] = true;
+            }
+        }
+
+        if (!capabilitySids.empty())
+        {
+            const vector<wstring_view> anyOf(capabilitySids.begin(), capabilitySids.end());
+            for (const uint32_t index : snapshot.QueryByCapabilities({}, anyOf, {}, nullopt))
+            {
+                matched[index] = true;
+            }
+        }
+
+        if (familyPatterns.Empty() && !hasWorkingDirectories) { return; }
+
+        for (const uint32_t index : dirty)
+        {
+            if (matched[index]) { continue; }
+
+            if (!familyPatterns.Empty() && familyPatterns.Match(FoldCase(snapshot.GetIdentity(index).FamilyName)))
+            {
+                matched[index] = true;
+            }
+            else if (hasWorkingDirectories)
+            {
+                const hstring workingDirectory = snapshot.GetAt(index).WorkingDirectory();
+                matched[index] = !workingDirectory.empty() && workingDirectories.FindLongestPrefix(workingDirectory) != PathTrie::NoOwner;
+            }
+        }
+    }
+
+    void ExemptionRuleEngine::AddCapability(const wstring_view pattern)
+    {
+        if (pattern.starts_with(L"S-") || pattern.starts_with(L"s-"))
+        {
+            capabilitySids.push_back(FoldCase(pattern));
+            return;
+        }
+
+        // Capability names are mapped to their SIDs the same way the package manager does.
+        typedef BOOL(WINAPI* DeriveCapabilitySidsFromNameFunc)(LPCWSTR, PSID**, DWORD*, PSID**, DWORD*);
+        static const DeriveCapabilitySidsFromNameFunc DeriveCapabilitySidsFromName =
+            (DeriveCapabilitySidsFromNameFunc)GetProcAddress(
+                GetModuleHandle(L"kernelbase.dll"),
+                "DeriveCapabilitySidsFromName");
+        if (!DeriveCapabilitySidsFromName) { return; }
+
+        PSID* groupSids = nullptr;
+        DWORD groupCount = 0;
+        PSID* sids = nullptr;
+        DWORD count = 0;
+        if (DeriveCapabilitySidsFromName(wstring(pattern).c_str(), &groupSids, &groupCount, &sids, &count))
+        {
+            for (DWORD i = 0; i < count; i++)
+            {
+                LPWSTR sid = nullptr;
+                if (ConvertSidToStringSid(sids[i], &sid) && sid)
+                {
+                    capabilitySids.push_back(FoldCase(sid));
+                    LocalFree(sid);
+                }
+                LocalFree(sids[i]);
+            }
+            for (DWORD i = 0; i < groupCount; i++)
+            {
+                LocalFree(groupSids[i]);
+            }
+            LocalFree(sids);
+            LocalFree(groupSids);
+        }
+    }
+}
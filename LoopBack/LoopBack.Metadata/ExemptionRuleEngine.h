@@ -0,0 +1,45 @@
+#pragma once
+
+#include "AppContainerSnapshot.h"
+#include "GlobSet.h"
+#include "PathTrie.h"
+#include <vector>
+
+using namespace winrt;
+using namespace LoopBack::Metadata;
+using namespace Windows::Foundation::Collections;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Kind and pattern of every rule, in the order they were given.
+    using ExemptionRuleList = std::vector<std::pair<ExemptionRuleKind, std::wstring>>;
+
+    // Evaluates a set of exemption rules against the containers of a snapshot. The compiled
+    // rules are kept between calls together with the result of the last snapshot, so a
+    // snapshot merged from that one only evaluates the containers MergeFrom found added or
+    // changed. Literal names and capabilities are answered by the snapshot indexes and the
+    // remaining patterns by a GlobSet and a PathTrie, so no container is visited per rule.
+    struct ExemptionRuleEngine
+    {
+        ExemptionRuleEngine() = default;
+
+        void Compile(const ExemptionRuleList& rules);
+
+        // Gets the indexes of the containers in snapshot that match a rule, ascending.
+        const std::vector<uint32_t> Evaluate(const AppContainerSnapshot& snapshot);
+
+    private:
+        ExemptionRuleList source;
+        std::vector<std::wstring> familyNames;
+        GlobSet familyPatterns;
+        std::vector<std::wstring> capabilitySids;
+        PathTrie workingDirectories;
+        bool hasWorkingDirectories = false;
+
+        uint64_t evaluatedSerial = 0;
+        std::vector<bool> results;
+
+        void Match(const AppContainerSnapshot& snapshot, const std::vector<uint32_t>& dirty, std::vector<bool>& matched) const;
+        void AddCapability(const std::wstring_view pattern);
+    };
+}
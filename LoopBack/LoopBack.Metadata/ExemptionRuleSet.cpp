@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "ExemptionRuleSet.h"
+#include "StorageHelpers.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    ExemptionRuleSet& ExemptionRuleSet::Current()
+    {
+        static ExemptionRuleSet ruleSet;
+        return ruleSet;
+    }
+
+    ExemptionRuleSet::ExemptionRuleSet() : path(GetStateFilePath(L"Exemptions.rules"))
+    {
+        try
+        {
+            Load();
+        }
+        catch (...)
+        {
+            //An unreadable file leaves the set empty until the next ApplyExemptionRules.
+        }
+    }
+
+    const shared_ptr<const ExemptionRuleList> ExemptionRuleSet::Get()
+    {
+        const lock_guard<mutex> guard(lock);
+        return rules;
+    }
+
+    void ExemptionRuleSet::Replace(const IIterable<ExemptionRule>& source)
+    {
+        ExemptionRuleList list;
+        for (ExemptionRule rule : source)
+        {
+            if (rule && !rule.Pattern().empty())
+            {
+                list.emplace_back(rule.Kind(), wstring(rule.Pattern()));
+            }
+        }
+
+        const lock_guard<mutex> guard(lock);
+        rules = make_shared<const ExemptionRuleList>(move(list));
+        Save();
+    }
+
+    void ExemptionRuleSet::Load()
+    {
+        const file_handle file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!file) { return; }
+
+        LARGE_INTEGER size{};
+        check_bool(GetFileSizeEx(file.get(), &size));
+        vector<uint8_t> buffer(static_cast<size_t>(size.QuadPart));
+        DWORD read = 0;
+        check_bool(ReadFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr));
+        buffer.resize(read);
+
+        uint32_t magic = 0;
+        if (buffer.size() < sizeof(magic)) { return; }
+        memcpy(&magic, buffer.data(), sizeof(magic));
+        if (magic != Magic) { return; }
+
+        //Each entry is the rule kind, the pattern length and the pattern characters.
+        ExemptionRuleList list;
+        size_t offset = sizeof(magic);
+        while (offset + sizeof(uint32_t) * 2 <= buffer.size())
+        {
+            uint32_t kind;
+            uint32_t length;
+            memcpy(&kind, buffer.data() + offset, sizeof(kind));
+            memcpy(&length, buffer.data() + offset + sizeof(kind), sizeof(length));
+            offset += sizeof(kind) + sizeof(length);
+            if (length > (buffer.size() - offset) / sizeof(wchar_t)) { break; }
+            wstring pattern(length, L'\0');
+            memcpy(pattern.data(), buffer.data() + offset, length * sizeof(wchar_t));
+            offset += length * sizeof(wchar_t);
+            list.emplace_back(static_cast<ExemptionRuleKind>(kind), move(pattern));
+        }
+        rules = make_shared<const ExemptionRuleList>(move(list));
+    }
+
+    void ExemptionRuleSet::Save() const
+    {
+        vector<uint8_t> buffer(sizeof(Magic));
+        memcpy(buffer.data(), &Magic, sizeof(Magic));
+        for (const auto& [kind, pattern] : *rules)
+        {
+            const uint32_t value = static_cast<uint32_t>(kind);
+            const uint32_t length = static_cast<uint32_t>(pattern.size());
+            const size_t offset = buffer.size();
+            buffer.resize(offset + sizeof(value) + sizeof(length) + length * sizeof(wchar_t));
+            memcpy(buffer.data() + offset, &value, sizeof(value));
+            memcpy(buffer.data() + offset + sizeof(value), &length, sizeof(length));
+            memcpy(buffer.data() + offset + sizeof(value) + sizeof(length), pattern.data(), length * sizeof(wchar_t));
+        }
+
+        //Write a sibling file and swap it in, so a crash never leaves a torn set behind.
+        const wstring temporary = path + L".tmp";
+        {
+            const file_handle file(CreateFile(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+            if (!file) { throw_last_error(); }
+            DWORD written = 0;
+            check_bool(WriteFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &written, nullptr));
+        }
+        check_bool(MoveFileEx(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+    }
+}
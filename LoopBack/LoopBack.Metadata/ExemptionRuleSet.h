@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ExemptionRuleEngine.h"
+#include <memory>
+#include <mutex>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Keeps the exemption rules of the process, so every client and every enumeration applies
+    // the same set. ApplyExemptionRules replaces the set, and each fresh enumeration of any
+    // LoopUtil evaluates it against its snapshot. The rules are mirrored to a state file and
+    // loaded again when the server starts. A list handed out by Get is never modified, so an
+    // instance compiles it outside the lock and recompiles only when it gets a new one.
+    struct ExemptionRuleSet
+    {
+        static ExemptionRuleSet& Current();
+
+        const std::shared_ptr<const ExemptionRuleList> Get();
+        void Replace(const IIterable<ExemptionRule>& rules);
+
+    private:
+        static constexpr uint32_t Magic = 0x31524C4C; // LLR1
+
+        std::mutex lock;
+        std::shared_ptr<const ExemptionRuleList> rules = std::make_shared<const ExemptionRuleList>();
+        std::wstring path;
+
+        ExemptionRuleSet();
+
+        void Load();
+        void Save() const;
+    };
+}
@@ -0,0 +1,170 @@
+#include "GlobSet.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    GlobPattern::GlobPattern(const wstring_view pattern) : source(pattern)
+    {
+        leadingStar = !source.empty() && source.front() == L'*';
+        trailingStar = !source.empty() && source.back() == L'*';
+
+        size_t start = 0;
+        while (start <= source.size())
+        {
+            const size_t end = source.find(L'*', start);
+            const wstring_view segment = wstring_view(source).substr(start, end == wstring::npos ? wstring::npos : end - start);
+            if (!segment.empty() || segments.empty())
+            {
+                segments.emplace_back(segment);
+            }
+            if (end == wstring::npos) { break; }
+            start = end + 1;
+        }
+    }
+
+    const bool GlobPattern::Match(const wstring_view value) const
+    {
+        if (IsLiteral())
+        {
+            return MatchSegment(value, segments.front()) && value.size() == segments.front().size();
+        }
+
+        size_t position = 0;
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            const wstring_view segment = segments[i];
+            if (segment.empty()) { continue; }
+
+            if (i == 0 && !leadingStar)
+            {
+                if (!MatchSegment(value, segment)) { return false; }
+                position = segment.size();
+            }
+            else if (i == segments.size() - 1 && !trailingStar)
+            {
+                if (value.size() < position + segment.size()) { return false; }
+                return MatchSegment(value.substr(value.size() - segment.size()), segment);
+            }
+            else
+            {
+                // The leftmost occurrence of a segment always leaves the most room for the rest.
+                bool found = false;
+                for (; position + segment.size() <= value.size(); position++)
+                {
+                    if (MatchSegment(value.substr(position), segment))
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) { return false; }
+                position += segment.size();
+            }
+        }
+
+        return trailingStar || position == value.size();
+    }
+
+    const wstring_view GlobPattern::Prefix() const
+    {
+        return wstring_view(source).substr(0, source.find_first_of(L"*?"));
+    }
+
+    const wstring_view GlobPattern::Suffix() const
+    {
+        const size_t last = source.find_last_of(L"*?");
+        return last == wstring::npos ? wstring_view(source) : wstring_view(source).substr(last + 1);
+    }
+
+    const bool GlobPattern::MatchSegment(const wstring_view value, const wstring_view segment)
+    {
+        if (value.size() < segment.size()) { return false; }
+        for (size_t i = 0; i < segment.size(); i++)
+        {
+            if (segment[i] != L'?' && segment[i] != value[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void GlobSet::AnchorIndex::Add(const wstring_view anchor, const uint32_t pattern)
+    {
+        patterns[wstring(anchor)].push_back(pattern);
+        const auto position = lower_bound(lengths.begin(), lengths.end(), anchor.size());
+        if (position == lengths.end() || *position != anchor.size())
+        {
+            lengths.insert(position, anchor.size());
+        }
+    }
+
+    void GlobSet::Add(const wstring_view pattern)
+    {
+        if (pattern.find_first_of(L"*?") == wstring_view::npos)
+        {
+            literals.emplace(pattern);
+            return;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(patterns.size());
+        const GlobPattern& compiled = patterns.emplace_back(pattern);
+
+        //The longer anchor narrows the candidates down the most.
+        const wstring_view prefix = compiled.Prefix();
+        const wstring_view suffix = compiled.Suffix();
+        if (prefix.empty() && suffix.empty())
+        {
+            unanchored.push_back(index);
+        }
+        else if (prefix.size() >= suffix.size())
+        {
+            prefixes.Add(prefix, index);
+        }
+        else
+        {
+            suffixes.Add(suffix, index);
+        }
+    }
+
+    void GlobSet::Clear()
+    {
+        literals.clear();
+        patterns.clear();
+        prefixes = {};
+        suffixes = {};
+        unanchored.clear();
+    }
+
+    const bool GlobSet::Match(const wstring_view value) const
+    {
+        if (literals.contains(value)) { return true; }
+
+        for (const size_t length : prefixes.lengths)
+        {
+            if (length > value.size()) { break; }
+            const auto candidates = prefixes.patterns.find(value.substr(0, length));
+            if (candidates != prefixes.patterns.end() && MatchAny(candidates->second, value)) { return true; }
+        }
+
+        for (const size_t length : suffixes.lengths)
+        {
+            if (length > value.size()) { break; }
+            const auto candidates = suffixes.patterns.find(value.substr(value.size() - length));
+            if (candidates != suffixes.patterns.end() && MatchAny(candidates->second, value)) { return true; }
+        }
+
+        return MatchAny(unanchored, value);
+    }
+
+    const bool GlobSet::MatchAny(const vector<uint32_t>& candidates, const wstring_view value) const
+    {
+        for (const uint32_t candidate : candidates)
+        {
+            if (patterns[candidate].Match(value)) { return true; }
+        }
+        return false;
+    }
+}
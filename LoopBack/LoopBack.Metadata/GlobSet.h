@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Glob pattern supporting '*' and '?', compiled into the literal segments between stars
+    // so that matching is a single left-to-right scan. Comparison is exact, so callers fold
+    // the case of both the pattern and the value beforehand.
+    struct GlobPattern
+    {
+        GlobPattern(const std::wstring_view pattern);
+
+        const bool IsLiteral() const { return segments.size() == 1 && !leadingStar && !trailingStar; }
+        const std::wstring& Literal() const { return segments.front(); }
+        const bool Match(const std::wstring_view value) const;
+
+        // The characters every match starts or ends with, up to the first wildcard.
+        const std::wstring_view Prefix() const;
+        const std::wstring_view Suffix() const;
+
+    private:
+        std::wstring source;
+        std::vector<std::wstring> segments;
+        bool leadingStar = false;
+        bool trailingStar = false;
+
+        static const bool MatchSegment(const std::wstring_view value, const std::wstring_view segment);
+    };
+
+    // A set of glob patterns matched as a whole. Literals are hashed, and every other pattern
+    // is filed under its literal prefix or suffix, so a value only runs the few patterns whose
+    // anchor it carries instead of every pattern in the set. Patterns without an anchor, such
+    // as "*foo*", are the only ones scanned one by one.
+    struct GlobSet
+    {
+        GlobSet() = default;
+
+        void Add(const std::wstring_view pattern);
+        void Clear();
+        const bool Empty() const { return literals.empty() && patterns.empty(); }
+        const bool Match(const std::wstring_view value) const;
+
+    private:
+        struct AnchorHash
+        {
+            using is_transparent = void;
+            const size_t operator()(const std::wstring_view value) const { return std::hash<std::wstring_view>{}(value); }
+        };
+
+        struct AnchorIndex
+        {
+            std::unordered_map<std::wstring, std::vector<uint32_t>, AnchorHash, std::equal_to<>> patterns;
+            std::vector<size_t> lengths;
+
+            void Add(const std::wstring_view anchor, const uint32_t pattern);
+        };
+
+        std::unordered_set<std::wstring, AnchorHash, std::equal_to<>> literals;
+        std::vector<GlobPattern> patterns;
+        AnchorIndex prefixes;
+        AnchorIndex suffixes;
+        std::vector<uint32_t> unanchored;
+
+        const bool MatchAny(const std::vector<uint32_t>& candidates, const std::wstring_view value) const;
+    };
+}
@@ -0,0 +1,179 @@
+#include "IndirectStringCache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    IndirectStringCache::IndirectStringCache(Resolver resolver, filesystem::path path) : resolver(move(resolver)), path(move(path))
+    {
+        if (!this->path.empty())
+        {
+            try
+            {
+                Load();
+            }
+            catch (...)
+            {
+                //A damaged cache only costs the resolution again.
+                values.clear();
+            }
+        }
+    }
+
+    void IndirectStringCache::SetResolver(Resolver value)
+    {
+        const lock_guard<mutex> guard(lock);
+        resolver = move(value);
+        failures.clear();
+    }
+
+    void IndirectStringCache::Prefetch(const vector<wstring>& references)
+    {
+        vector<wstring> pending;
+        Resolver current;
+        {
+            const lock_guard<mutex> guard(lock);
+            unordered_set<wstring_view> seen;
+            for (const wstring& reference : references)
+            {
+                if (IsIndirect(reference) && !values.contains(reference) && !failures.contains(reference) && seen.insert(reference).second)
+                {
+                    pending.push_back(reference);
+                }
+            }
+            current = resolver;
+        }
+        if (pending.empty()) { return; }
+
+        //Each lookup loads a resource file of its own, so they are spread over a few workers.
+        vector<optional<wstring>> results(pending.size());
+        atomic<size_t> next = 0;
+        const auto work = [&]()
+            {
+                for (size_t i = next++; i < pending.size(); i = next++)
+                {
+                    try
+                    {
+                        results[i] = current(pending[i]);
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+            };
+        const size_t count = min<size_t>(pending.size(), max(thread::hardware_concurrency(), 1u));
+        vector<thread> workers;
+        for (size_t i = 1; i < count; i++)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+        for (thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        const lock_guard<mutex> guard(lock);
+        bool isChanged = false;
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            if (results[i])
+            {
+                isChanged |= values.insert_or_assign(move(pending[i]), move(*results[i])).second;
+            }
+            else
+            {
+                failures.insert(move(pending[i]));
+            }
+        }
+        if (isChanged && !path.empty())
+        {
+            try
+            {
+                Save();
+            }
+            catch (...)
+            {
+                //The values are still served from memory.
+            }
+        }
+    }
+
+    const wstring IndirectStringCache::Resolve(const wstring_view value)
+    {
+        if (IsIndirect(value))
+        {
+            const lock_guard<mutex> guard(lock);
+            const auto item = values.find(wstring(value));
+            if (item != values.end()) { return item->second; }
+        }
+        return wstring(value);
+    }
+
+    void IndirectStringCache::Load()
+    {
+        ifstream file(path, ios::binary);
+        if (!file) { return; }
+        const vector<uint8_t> buffer((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        uint32_t magic = 0;
+        if (buffer.size() < sizeof(magic)) { return; }
+        memcpy(&magic, buffer.data(), sizeof(magic));
+        if (magic != Magic) { return; }
+
+        //Each entry is the reference and the resolved value, both prefixed with their length.
+        size_t offset = sizeof(magic);
+        const auto readString = [&](wstring& value)
+            {
+                uint32_t length;
+                if (offset + sizeof(length) > buffer.size()) { return false; }
+                memcpy(&length, buffer.data() + offset, sizeof(length));
+                offset += sizeof(length);
+                if (length > (buffer.size() - offset) / sizeof(wchar_t)) { return false; }
+                value.resize(length);
+                memcpy(value.data(), buffer.data() + offset, length * sizeof(wchar_t));
+                offset += length * sizeof(wchar_t);
+                return true;
+            };
+        wstring reference, value;
+        while (readString(reference) && readString(value))
+        {
+            values.insert_or_assign(move(reference), move(value));
+        }
+    }
+
+    void IndirectStringCache::Save() const
+    {
+        vector<uint8_t> buffer(sizeof(Magic));
+        memcpy(buffer.data(), &Magic, sizeof(Magic));
+        const auto writeString = [&](const wstring& value)
+            {
+                const uint32_t length = static_cast<uint32_t>(value.size());
+                const size_t offset = buffer.size();
+                buffer.resize(offset + sizeof(length) + length * sizeof(wchar_t));
+                memcpy(buffer.data() + offset, &length, sizeof(length));
+                memcpy(buffer.data() + offset + sizeof(length), value.data(), length * sizeof(wchar_t));
+            };
+        for (const auto& [reference, value] : values)
+        {
+            writeString(reference);
+            writeString(value);
+        }
+
+        //Write a sibling file and swap it in, so a crash never leaves a torn cache behind.
+        filesystem::path temporary = path;
+        temporary += L".tmp";
+        {
+            ofstream file(temporary, ios::binary | ios::trunc);
+            file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<streamsize>(buffer.size()));
+            if (!file.flush()) { throw ios_base::failure("The cache could not be written."); }
+        }
+        filesystem::rename(temporary, path);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Resolves @{PackageFullName?ms-resource://...} indirect strings. The reference names both
+    // the package and the resource, so it is the cache key as is. References seen for the first
+    // time are resolved in parallel, and resolved values are mirrored to a state file so later
+    // enumerations and server restarts never load the package resources again. Failures are only
+    // remembered until the server exits, since a package being installed may resolve later.
+    // Only Current and LoadIndirectString, in IndirectStringResolver.cpp, use the Windows SDK;
+    // the cache itself is standard C++ and can be tested anywhere with a stand-in resolver.
+    struct IndirectStringCache
+    {
+        // Called on the worker threads of Prefetch, so it must be safe to call concurrently.
+        using Resolver = std::function<std::optional<std::wstring>(const std::wstring_view reference)>;
+
+        static IndirectStringCache& Current();
+
+        IndirectStringCache(Resolver resolver, std::filesystem::path path);
+
+        static const bool IsIndirect(const std::wstring_view value) { return value.starts_with(L"@{"); }
+
+        // Replaces the resolver, for example with a stand-in that does not need the package resources.
+        void SetResolver(Resolver value);
+
+        // Resolves every reference that is not cached yet, in parallel, and saves the new values.
+        void Prefetch(const std::vector<std::wstring>& references);
+        // Gets the resolved value, or the reference itself when it cannot be resolved.
+        const std::wstring Resolve(const std::wstring_view value);
+
+    private:
+        static constexpr uint32_t Magic = 0x31524C4C; // LLR1
+
+        std::mutex lock;
+        Resolver resolver;
+        std::filesystem::path path;
+        std::unordered_map<std::wstring, std::wstring> values;
+        std::unordered_set<std::wstring> failures;
+
+        static const std::optional<std::wstring> LoadIndirectString(const std::wstring_view reference);
+        void Load();
+        void Save() const;
+    };
+}
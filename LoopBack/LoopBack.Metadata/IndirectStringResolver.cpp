@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "IndirectStringCache.h"
+#include "StorageHelpers.h"
+#include <shlwapi.h>
+
+#pragma comment(lib,"shlwapi.lib")
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    namespace
+    {
+        //Joins the MTA on the first lookup of a thread and leaves it when the thread exits.
+        //A thread that is in an apartment already is left as it is.
+        struct ApartmentScope
+        {
+            ApartmentScope() : isJoined(SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {}
+
+            ~ApartmentScope()
+            {
+                if (isJoined)
+                {
+                    CoUninitialize();
+                }
+            }
+
+        private:
+            const bool isJoined;
+        };
+    }
+
+    IndirectStringCache& IndirectStringCache::Current()
+    {
+        static IndirectStringCache cache(LoadIndirectString, GetStateFilePath(L"IndirectStrings.cache"));
+        return cache;
+    }
+
+    const optional<wstring> IndirectStringCache::LoadIndirectString(const wstring_view reference)
+    {
+        thread_local const ApartmentScope apartment;
+        const wstring source(reference);
+        wchar_t buffer[1024];
+        if (FAILED(SHLoadIndirectString(source.c_str(), buffer, ARRAYSIZE(buffer), nullptr))) { return nullopt; }
+        return wstring(buffer);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <bit>
+#include <string>
+#include <string_view>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LOOPBACK_JSON_ESCAPE_SSE2
+#endif
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Appends UTF-8 value to output with JSON string escaping applied. Runs without a quote,
+    // a backslash or a control character are copied as they are; on x86 and x64 they are
+    // found 16 bytes at a time with SSE2, elsewhere and for the tail one byte at a time.
+    inline void EscapeJson(const std::string_view value, std::string& output)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        const char* data = value.data();
+        const size_t size = value.size();
+        size_t i = 0;
+        while (i < size)
+        {
+            size_t run = i;
+#ifdef LOOPBACK_JSON_ESCAPE_SSE2
+            //Skip 16 bytes at a time while none of them is a quote, a backslash or a control character.
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            while (run + 16 <= size)
+            {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + run));
+                const __m128i isControl = _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control);
+                const __m128i isSpecial = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), isControl);
+                const int mask = _mm_movemask_epi8(isSpecial);
+                if (mask)
+                {
+                    run += std::countr_zero(static_cast<unsigned int>(mask));
+                    break;
+                }
+                run += 16;
+            }
+#endif
+            while (run < size)
+            {
+                const unsigned char c = static_cast<unsigned char>(data[run]);
+                if (c < 0x20 || c == '"' || c == '\\') { break; }
+                run++;
+            }
+
+            output.append(data + i, run - i);
+            if (run == size) { break; }
+
+            const unsigned char c = static_cast<unsigned char>(data[run]);
+            switch (c)
+            {
+            case '"': output.append("\\\""); break;
+            case '\\': output.append("\\\\"); break;
+            case '\b': output.append("\\b"); break;
+            case '\f': output.append("\\f"); break;
+            case '\n': output.append("\\n"); break;
+            case '\r': output.append("\\r"); break;
+            case '\t': output.append("\\t"); break;
+            default:
+                output.append("\\u00");
+                output.push_back(hex[c >> 4]);
+                output.push_back(hex[c & 0xF]);
+                break;
+            }
+            i = run + 1;
+        }
+    }
+}
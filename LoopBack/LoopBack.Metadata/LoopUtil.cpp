@@ -1,87 +1,334 @@
 ﻿#include "pch.h"
 #include "LoopUtil.h"
 #include "LoopUtil.g.cpp"
+#include "AppContainerChange.h"
+#include "AppContainerExporter.h"
+#include "ConfigListAudit.h"
+#include "ExemptionAuditReport.h"
+#include "ExemptionExpiry.h"
+#include "ExemptionJournal.h"
+#include "ExemptionRuleSet.h"
+#include "IndirectStringCache.h"
+#include "RequestScheduler.h"
+#include "SidArray.h"
+#include "SnapshotPublisher.h"
+#include "SpanTracer.h"
 
 using namespace std;
 
 namespace winrt::LoopBack::Metadata::implementation
 {
     IVectorView<AppContainer> LoopUtil::GetAppContainers()
+    {
+        TraceSpan span("GetAppContainers");
+        const shared_ptr<AppContainerSnapshot> previous = snapshot;
+        if (LoadAppContainers())
+        {
+            //An enumeration that found what this instance had already keeps the old snapshot,
+            //which was published when it was new.
+            const bool isUnchanged = RestoreIfUnchanged(previous);
+            ApplyStoredRules(nullptr);
+            if (!isUnchanged)
+            {
+                PublishSnapshot();
+            }
+        }
+        return apps.GetView();
+    }
+
+    const bool LoopUtil::LoadAppContainers()
+    {
+        //A build abandoned by an earlier timeout, or the one started with the server, is
+        //joined rather than started again.
+        if (!pendingBuild && userScope.empty())
+        {
+            pendingBuild = TakeWarmup();
+        }
+        if (!pendingBuild)
+        {
+            pendingBuild = StartBuild(userScope, RequestClass::InteractiveRead);
+        }
+
+        if (!pendingBuild->Wait(chrono::duration_cast<chrono::milliseconds>(backendTimeout)))
+        {
+            if (!snapshot) { throw hresult_error(HRESULT_FROM_WIN32(ERROR_TIMEOUT), L"The firewall service did not respond in time."); }
+            isStale = true;
+            return false;
+        }
+
+        const shared_ptr<BuildCall> build = move(pendingBuild);
+        const com_ptr<LoopUtil> worker = build->Get();
+        appListConfig = worker->appListConfig;
+        snapshot = worker->snapshot;
+        snapshotTime = chrono::steady_clock::now();
+        apps.ReplaceAll(snapshot->Apps());
+        isStale = false;
+        return true;
+    }
+
+    IVectorView<AppContainer> LoopUtil::GetAppContainersWithFields(const AppContainerFields& fields)
+    {
+        if ((fields & AppContainerFields::All) == AppContainerFields::All) { return GetAppContainers(); }
+
+        if (!snapshot || isStale || chrono::steady_clock::now() - snapshotTime > SnapshotFreshness)
+        {
+            //Only the requested fields are built, and the snapshot is left as it is, since it
+            //needs every field for its indexes.
+            const shared_ptr<BuildCall> build = StartBuild(userScope, RequestClass::InteractiveRead, fields);
+            if (build->Wait(chrono::duration_cast<chrono::milliseconds>(backendTimeout)))
+            {
+                return build->Get()->apps.GetView();
+            }
+            if (!snapshot) { throw hresult_error(HRESULT_FROM_WIN32(ERROR_TIMEOUT), L"The firewall service did not respond in time."); }
+            isStale = true;
+        }
+
+        //The snapshot keeps every field for its indexes, so projecting is a copy of references.
+        vector<AppContainer> result;
+        result.reserve(apps.Size());
+        for (const AppContainer& app : snapshot->Apps())
+        {
+            result.push_back(ProjectAppContainer(app, fields));
+        }
+        return single_threaded_vector<AppContainer>(move(result)).GetView();
+    }
+
+    const AppContainer LoopUtil::ProjectAppContainer(const AppContainer& app, const AppContainerFields& fields)
+    {
+        const auto has = [&](const AppContainerFields field) { return (fields & field) == field; };
+        AppContainer result = AppContainer::AppContainer();
+        result.Fields(fields & AppContainerFields::All);
+        if (has(AppContainerFields::IsEnableLoop)) { result.IsEnableLoop(app.IsEnableLoop()); }
+        if (has(AppContainerFields::DisplayName)) { result.DisplayName(app.DisplayName()); }
+        if (has(AppContainerFields::Description)) { result.Description(app.Description()); }
+        if (has(AppContainerFields::AppContainerName)) { result.AppContainerName(app.AppContainerName()); }
+        if (has(AppContainerFields::PackageFullName)) { result.PackageFullName(app.PackageFullName()); }
+        if (has(AppContainerFields::WorkingDirectory)) { result.WorkingDirectory(app.WorkingDirectory()); }
+        if (has(AppContainerFields::AppContainerSid)) { result.AppContainerSid(app.AppContainerSid()); }
+        if (has(AppContainerFields::UserSid)) { result.UserSid(app.UserSid()); }
+        if (has(AppContainerFields::Capabilities)) { result.Capabilities(app.Capabilities()); }
+        if (has(AppContainerFields::Binaries)) { result.Binaries(app.Binaries()); }
+        return result;
+    }
+
+    void LoopUtil::StartWarmup()
+    {
+        const lock_guard<mutex> guard(warmupLock);
+        if (warmupBuild) { return; }
+        warmupBuild = StartBuild(L"", RequestClass::BackgroundRefresh);
+        warmupStarted = chrono::steady_clock::now();
+    }
+
+    shared_ptr<LoopUtil::BuildCall> LoopUtil::TakeWarmup()
+    {
+        const lock_guard<mutex> guard(warmupLock);
+        shared_ptr<BuildCall> build = move(warmupBuild);
+        //Only a recent build is worth handing out, an older one may miss later changes.
+        if (build && chrono::steady_clock::now() - warmupStarted > chrono::minutes(1))
+        {
+            build = nullptr;
+        }
+        return build;
+    }
+
+    shared_ptr<LoopUtil::BuildCall> LoopUtil::StartBuild(const hstring& scope, const RequestClass requestClass, const AppContainerFields fields)
+    {
+        return BuildCall::Start([scope, requestClass, fields]()
+            {
+                init_apartment();
+                //The worker has its own instance, and so its own reference to FirewallAPI,
+                //so a hung call never touches the caller after it has been abandoned.
+                com_ptr<LoopUtil> worker = nullptr;
+                try
+                {
+                    worker = make_self<LoopUtil>();
+                    worker->userScope = scope;
+                    RequestScheduler::Current().Admit(requestClass);
+                    worker->EnumerateAppContainers(fields);
+                }
+                catch (...)
+                {
+                    uninit_apartment();
+                    throw;
+                }
+                uninit_apartment();
+                return worker;
+            });
+    }
+
+    void LoopUtil::EnumerateAppContainers(const AppContainerFields fields)
     {
         apps.Clear();
+        const bool isProjected = (fields & AppContainerFields::All) != AppContainerFields::All;
         //List of Apps that have LoopUtil enabled.
-        appListConfig = PI_NetworkIsolationGetAppContainerConfig();
-        //Full List of Apps
-        return PI_NetworkIsolationEnumAppContainers(apps);
+        if (!isProjected || (fields & AppContainerFields::IsEnableLoop) == AppContainerFields::IsEnableLoop)
+        {
+            appListConfig = PI_NetworkIsolationGetAppContainerConfig();
+        }
+        //Full List of Apps, a projection has no snapshot to index it.
+        snapshot = isProjected ? nullptr : make_shared<AppContainerSnapshot>();
+        PI_NetworkIsolationEnumAppContainers(apps, snapshot.get(), fields & AppContainerFields::All);
     }
 
-    const HRESULT LoopUtil::SetLoopbackList(const IIterable<hstring>& list) const try
+    IVectorView<LoopBack::Metadata::AppContainerChange> LoopUtil::GetAppContainerChanges()
     {
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        TraceSpan span("GetAppContainerChanges");
+        const shared_ptr<AppContainerSnapshot> previous = snapshot;
+        vector<LoopBack::Metadata::AppContainerChange> changes;
+        //A stale result has nothing new to report.
+        if (!LoadAppContainers()) { return single_threaded_vector<LoopBack::Metadata::AppContainerChange>().GetView(); }
 
-        for (hstring app : list)
+        const bool isUnchanged = RestoreIfUnchanged(previous);
+        if (isUnchanged)
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            //The same content has nothing new to report, unless the rules change it below.
+        }
+        else if (previous)
+        {
+            snapshot->MergeFrom(*previous, changes);
+            //Unchanged containers were swapped back to the instances the caller already holds.
+            apps.ReplaceAll(snapshot->Apps());
+        }
+        else
+        {
+            for (AppContainer app : apps)
+            {
+                changes.push_back(make<implementation::AppContainerChange>(AppContainerChangeKind::Added, AppContainerFields::All, nullptr, app));
+            }
         }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        //The rules run on the merged snapshot, so only the containers it found added or changed
+        //are matched again.
+        ApplyStoredRules(&changes);
+        if (!isUnchanged)
+        {
+            PublishSnapshot();
+        }
+
+        return single_threaded_vector<LoopBack::Metadata::AppContainerChange>(move(changes)).GetView();
     }
-    catch (...)
+
+    IVectorView<AppContainer> LoopUtil::GetAppContainersIfModified(const uint64_t etag)
     {
-        return to_hresult();
+        GetAppContainers();
+        return snapshot->ETag() != etag ? apps.GetView() : nullptr;
     }
 
-    const HRESULT LoopUtil::SetLoopbackList(const IIterable<AppContainer>& list) const try
+    const bool LoopUtil::RestoreIfUnchanged(const shared_ptr<AppContainerSnapshot>& previous)
     {
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        if (!previous || previous == snapshot || previous->ETag() != snapshot->ETag()) { return false; }
+        //Keep the instances callers already hold instead of diffing identical content.
+        snapshot = previous;
+        apps.ReplaceAll(snapshot->Apps());
+        return true;
+    }
+
+    IVectorView<AppContainer> LoopUtil::GetAppContainersForUser(const hstring& userSid)
+    {
+        return GetAppContainersAt(GetSnapshot().FindByUserSid(userSid));
+    }
 
-        for (AppContainer app : list)
+    IVectorView<AppContainer> LoopUtil::GetSortedAppContainers(const AppContainerSortColumn& column, const bool ascending, const hstring& filter)
+    {
+        return GetAppContainersAt(GetSnapshot().GetSorted(column, ascending, filter));
+    }
+
+    SnapshotSectionHandles LoopUtil::ShareSnapshotSection()
+    {
+        GetSnapshot();
+        PublishSnapshot();
+        return SnapshotPublisher::Current().Share(userScope);
+    }
+
+    void LoopUtil::PublishSnapshot() const
+    {
+        //A stale snapshot was published when it was fresh, and a scoped one only goes to its own scope.
+        if (!snapshot || isStale) { return; }
+        try
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.AppContainerSid().c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            SnapshotPublisher::Current().Publish(userScope, snapshot->Serial(), snapshot->ETag(), snapshot->Apps());
+        }
+        catch (...)
+        {
+            //Readers keep the previous version, the COM path still has the new one.
+        }
+    }
+
+    const HRESULT LoopUtil::ExportAppContainers(const hstring& path, const AppContainerExportFormat& format) const try
+    {
+        TraceSpan span("ExportAppContainers");
+        AppContainerExporter exporter(path, format);
+
+        unordered_set<hstring> configSet;
+        for (const hstring& sid : PI_NetworkIsolationGetAppContainerConfig())
+        {
+            configSet.insert(sid);
         }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        DWORD size = 0;
+        PINET_FIREWALL_APP_CONTAINER arrayValue = nullptr;
+        const HRESULT hr = HRESULT_FROM_WIN32(NetworkIsolationEnumAppContainers(NETISO_FLAG::NETISO_FLAG_MAX, &size, &arrayValue));
+        if (FAILED(hr)) { return hr; }
+
+        //The records are written as they come, the enumeration buffer is the only copy.
+        try
+        {
+            exporter.Begin();
+            for (DWORD i = 0; arrayValue && i < size; i++)
+            {
+                const INET_FIREWALL_APP_CONTAINER& cur = arrayValue[i];
+                bool isEnableLoop = false;
+                LPWSTR sid = nullptr;
+                if (cur.appContainerSid && ConvertSidToStringSid(cur.appContainerSid, &sid) && sid)
+                {
+                    isEnableLoop = configSet.contains(sid);
+                    LocalFree(sid);
+                }
+                exporter.Write(cur, isEnableLoop);
+            }
+            exporter.End();
+        }
+        catch (...)
+        {
+            PI_NetworkIsolationFreeAppContainers(arrayValue);
+            throw;
+        }
+        PI_NetworkIsolationFreeAppContainers(arrayValue);
+
+        return S_OK;
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::AddLookback(const hstring& stringSid) const try
+    const HRESULT LoopUtil::SetLoopbackList(const IIterable<hstring>& list) const try
+    {
+        return CommitLoopbackList(list);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::SetLoopbackList(const IIterable<AppContainer>& list) const try
+    {
+        return CommitLoopbackList(list);
+    }
+    catch (...)
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(stringSid, true);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        return to_hresult();
+    }
 
-        for (hstring app : enabledList)
+    const HRESULT LoopUtil::AddLookback(const hstring& stringSid) const try
+    {
+        const HRESULT result = CommitLoopbackChanges(stringSid, true);
+        if (SUCCEEDED(result))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            //An explicit change replaces any pending expiry of the SID.
+            ExemptionExpiry::Current().Cancel(stringSid);
         }
-
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        return result;
     }
     catch (...)
     {
@@ -90,23 +337,13 @@ namespace winrt::LoopBack::Metadata::implementation
 
     const HRESULT LoopUtil::AddLookback(const AppContainer& appContainer) const try
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(appContainer.AppContainerSid(), true);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
-
-        for (hstring app : enabledList)
+        const HRESULT result = CommitLoopbackChanges(appContainer, true);
+        if (SUCCEEDED(result))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            //An explicit change replaces any pending expiry of the SID.
+            ExemptionExpiry::Current().Cancel(appContainer.AppContainerSid());
         }
-
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        return result;
     }
     catch (...)
     {
@@ -115,184 +352,490 @@ namespace winrt::LoopBack::Metadata::implementation
 
     const HRESULT LoopUtil::AddLookbacks(const IIterable<hstring>& list) const try
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(list, true);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        return CommitLoopbackChanges(list, true);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::AddLookbacks(const IIterable<AppContainer>& list) const try
+    {
+        return CommitLoopbackChanges(list, true);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
 
-        for (hstring app : enabledList)
+    const HRESULT LoopUtil::RemoveLookback(const hstring& stringSid) const try
+    {
+        const HRESULT result = CommitLoopbackChanges(stringSid, false);
+        if (SUCCEEDED(result))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            //An explicit change replaces any pending expiry of the SID.
+            ExemptionExpiry::Current().Cancel(stringSid);
         }
-
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        return result;
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::AddLookbacks(const IIterable<AppContainer>& list) const try
+    const HRESULT LoopUtil::RemoveLookback(const AppContainer& appContainer) const try
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(list, true);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
-
-        for (hstring app : enabledList)
+        const HRESULT result = CommitLoopbackChanges(appContainer, false);
+        if (SUCCEEDED(result))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            //An explicit change replaces any pending expiry of the SID.
+            ExemptionExpiry::Current().Cancel(appContainer.AppContainerSid());
         }
+        return result;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+    const HRESULT LoopUtil::RemoveLookbacks(const IIterable<hstring>& list) const try
+    {
+        return CommitLoopbackChanges(list, false);
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::RemoveLookback(const hstring& stringSid) const try
+    const HRESULT LoopUtil::RemoveLookbacks(const IIterable<AppContainer>& list) const try
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(stringSid, false);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        return CommitLoopbackChanges(list, false);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
 
-        for (hstring app : enabledList)
+    const HRESULT LoopUtil::ApplyExemptionRules(const IIterable<ExemptionRule>& rules) try
+    {
+        //The rules are kept for every later enumeration of every client, and applied now to
+        //what this instance has.
+        ExemptionRuleSet& ruleSet = ExemptionRuleSet::Current();
+        ruleSet.Replace(rules);
+        GetSnapshot();
+        return ApplyRules(ruleSet.Get(), nullptr);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    void LoopUtil::ApplyStoredRules(vector<LoopBack::Metadata::AppContainerChange>* changes)
+    {
+        try
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            ApplyRules(ExemptionRuleSet::Current().Get(), changes);
         }
+        catch (...)
+        {
+            //The enumeration still succeeds, and the next one tries the rules again.
+        }
+    }
+
+    const HRESULT LoopUtil::ApplyRules(const shared_ptr<const ExemptionRuleList>& rules, vector<LoopBack::Metadata::AppContainerChange>* changes)
+    {
+        if (rules->empty() || !snapshot) { return S_OK; }
+        if (rules != compiledRules)
+        {
+            ruleEngine.Compile(*rules);
+            compiledRules = rules;
+        }
+
+        //Rules only ever add exemptions, so only the new matches are committed, on top of the
+        //live configuration rather than the snapshot, which other clients may have changed since.
+        vector<hstring> newMatches;
+        vector<AppContainer> newApps;
+        for (const uint32_t i : ruleEngine.Evaluate(*snapshot))
+        {
+            const AppContainer& app = snapshot->GetAt(i);
+            if (!app.IsEnableLoop())
+            {
+                newMatches.push_back(app.AppContainerSid());
+                newApps.push_back(app);
+            }
+        }
+        if (newMatches.empty()) { return S_OK; }
+
+        //Containers the change set does not hold yet are reported as changed by the rules, with
+        //a copy of what the caller saw before as the old value.
+        vector<LoopBack::Metadata::AppContainerChange> ruleChanges;
+        if (changes)
+        {
+            unordered_set<hstring> reportedSet;
+            for (const LoopBack::Metadata::AppContainerChange& change : *changes)
+            {
+                if (change.NewValue()) { reportedSet.insert(change.NewValue().AppContainerSid()); }
+            }
+            for (const AppContainer& app : newApps)
+            {
+                if (!reportedSet.contains(app.AppContainerSid()))
+                {
+                    ruleChanges.push_back(make<implementation::AppContainerChange>(AppContainerChangeKind::Changed, AppContainerFields::IsEnableLoop, ProjectAppContainer(app, AppContainerFields::All), app));
+                }
+            }
+        }
+
+        const HRESULT result = CommitLoopbackChanges(newMatches, true);
+        if (SUCCEEDED(result) && changes)
+        {
+            changes->insert(changes->end(), ruleChanges.begin(), ruleChanges.end());
+        }
+        return result;
+    }
+
+    AppContainer LoopUtil::FindBySid(const hstring& stringSid)
+    {
+        return GetSnapshot().FindBySid(stringSid);
+    }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+    IVectorView<AppContainer> LoopUtil::FindByPackageFamilyName(const hstring& familyName)
+    {
+        return GetAppContainersAt(GetSnapshot().FindByPackageFamilyName(familyName));
+    }
+
+    IVectorView<AppContainer> LoopUtil::FindByPublisherId(const hstring& publisherId)
+    {
+        return GetAppContainersAt(GetSnapshot().FindByPublisherId(publisherId));
+    }
+
+    AppContainer LoopUtil::FindByPath(const hstring& path)
+    {
+        return GetSnapshot().FindByPath(path);
+    }
+
+    IVectorView<AppContainer> LoopUtil::QueryByCapabilities(const IIterable<hstring>& allOf, const IIterable<hstring>& anyOf, const IIterable<hstring>& noneOf, const IReference<bool>& isEnableLoop)
+    {
+        const auto collect = [](const IIterable<hstring>& source, vector<hstring>& values, vector<wstring_view>& views)
+            {
+                if (!source) { return; }
+                for (const hstring& value : source)
+                {
+                    values.push_back(value);
+                }
+                views.assign(values.begin(), values.end());
+            };
+
+        vector<hstring> allValues, anyValues, noneValues;
+        vector<wstring_view> allViews, anyViews, noneViews;
+        collect(allOf, allValues, allViews);
+        collect(anyOf, anyValues, anyViews);
+        collect(noneOf, noneValues, noneViews);
+
+        const optional<bool> isEnable = isEnableLoop ? optional<bool>(isEnableLoop.Value()) : nullopt;
+        return GetAppContainersAt(GetSnapshot().QueryByCapabilities(allViews, anyViews, noneViews, isEnable));
+    }
+
+    IVectorView<ExemptionItemResult> LoopUtil::SetLoopbackListWithResults(const array_view<hstring const>& list)
+    {
+        vector<ExemptionItemResult> results;
+        const vector<hstring> validList = ValidateSids(list, false, results);
+        //Committing the empty remainder of a list that failed validation would clear every exemption.
+        if (validList.empty() && !list.empty()) { return CompleteResults(results, S_OK); }
+        return CompleteResults(results, CommitLoopbackList(validList));
+    }
+
+    IVectorView<ExemptionItemResult> LoopUtil::AddLookbacksWithResults(const array_view<hstring const>& list)
+    {
+        vector<ExemptionItemResult> results;
+        const vector<hstring> validList = ValidateSids(list, false, results);
+        uint32_t committed = 0;
+        return CompleteResults(results, validList.empty() ? S_OK : CommitLoopbackChanges(validList, true, &committed), committed);
+    }
+
+    IVectorView<ExemptionItemResult> LoopUtil::RemoveLookbacksWithResults(const array_view<hstring const>& list)
+    {
+        vector<ExemptionItemResult> results;
+        const vector<hstring> validList = ValidateSids(list, true, results);
+        uint32_t committed = 0;
+        return CompleteResults(results, validList.empty() ? S_OK : CommitLoopbackChanges(validList, false, &committed), committed);
+    }
+
+    const HRESULT LoopUtil::AddTemporaryLookback(const AppContainer& appContainer, const TimeSpan& duration) const try
+    {
+        return AddTemporaryLookbackBySid(appContainer.AppContainerSid(), duration);
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::RemoveLookback(const AppContainer& appContainer) const try
+    const HRESULT LoopUtil::AddTemporaryLookbackBySid(const hstring& stringSid, const TimeSpan& duration) const try
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(appContainer.AppContainerSid(), false);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
-
-        for (hstring app : enabledList)
+        if (duration <= TimeSpan::zero()) { return E_INVALIDARG; }
+        const HRESULT result = AddLookback(stringSid);
+        if (SUCCEEDED(result))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            ExemptionExpiry::Current().Schedule(stringSid, duration);
         }
+        return result;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    IReference<DateTime> LoopUtil::GetLookbackExpiry(const hstring& stringSid) const
+    {
+        const optional<DateTime> expiry = ExemptionExpiry::Current().GetExpiry(stringSid);
+        return expiry ? box_value(*expiry).as<IReference<DateTime>>() : nullptr;
+    }
+
+    const HRESULT LoopUtil::RemoveExpiredLookbacks(const vector<hstring>& list)
+    {
+        SidArray expiredList;
+        expiredList.AppendAll(list);
+        HRESULT result = S_OK;
+        RequestScheduler::Current().Run(RequestClass::BackgroundRefresh, [&]()
+            {
+                //Work from the live configuration, since this runs without an enumerated snapshot.
+                const lock_guard<recursive_mutex> guard(commitLock);
+                SidArray remainingList;
+                result = ReadConfigList(remainingList, &expiredList) == 0 ? S_OK : CommitConfigList(remainingList);
+            });
+        return result;
+    }
+
+    LoopBack::Metadata::ExemptionAuditReport LoopUtil::AuditExemptions()
+    {
+        vector<hstring> orphanedList;
+        vector<hstring> duplicateList;
+        const AppContainerSnapshot& index = GetSnapshot();
+        const IVector<hstring> configList = PI_NetworkIsolationGetAppContainerConfig();
+        AuditConfigList(index, configList, nullptr, &orphanedList, &duplicateList);
+        return make<implementation::ExemptionAuditReport>(
+            configList.Size(),
+            single_threaded_vector<hstring>(move(orphanedList)).GetView(),
+            single_threaded_vector<hstring>(move(duplicateList)).GetView());
+    }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+    const HRESULT LoopUtil::CompactExemptions() try
+    {
+        //Dropping entries on the word of an old snapshot could remove live exemptions.
+        GetAppContainers();
+        if (isStale) { return HRESULT_FROM_WIN32(ERROR_TIMEOUT); }
+
+        //The snapshot is taken before the turn, an enumeration started in it would wait for the
+        //turn this thread holds.
+        const shared_ptr<AppContainerSnapshot> index = snapshot;
+        HRESULT result = S_OK;
+        RequestScheduler::Current().Run(RequestClass::InteractiveWrite, [&]()
+            {
+                const lock_guard<recursive_mutex> guard(commitLock);
+                vector<hstring> keptList;
+                const IVector<hstring> configList = PI_NetworkIsolationGetAppContainerConfig();
+                AuditConfigList(*index, configList, &keptList, nullptr, nullptr);
+                if (keptList.size() == configList.Size()) { return; }
+                SidArray keptSids;
+                keptSids.AppendAll(keptList);
+                result = CommitConfigList(keptSids);
+            });
+        return result;
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::RemoveLookbacks(const IIterable<hstring>& list) const try
+    void LoopUtil::AuditConfigList(const AppContainerSnapshot& index, const IVector<hstring>& configList, vector<hstring>* keptList, vector<hstring>* orphanedList, vector<hstring>* duplicateList)
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(list, false);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        //Exemptions of other users' containers are live even though they are not in the snapshot.
+        const vector<hstring>& preservedList = index.PreservedSids();
+        const unordered_set<hstring> preservedSet(preservedList.begin(), preservedList.end());
+        const auto isLive = [&](const hstring& sid) { return index.FindBySid(sid) || preservedSet.contains(sid); };
+        AuditSidList<hstring>(configList, configList.Size(), isLive, keptList, orphanedList, duplicateList);
+    }
 
-        for (hstring app : enabledList)
-        {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
-        }
+    const HRESULT LoopUtil::SetLoopbackListFromArray(const array_view<hstring const>& list) const try
+    {
+        return CommitLoopbackList(list);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+    const HRESULT LoopUtil::SetLoopbackListFromBinary(const array_view<uint8_t const>& sids) const try
+    {
+        return CommitLoopbackList(sids);
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const HRESULT LoopUtil::RemoveLookbacks(const IIterable<AppContainer>& list) const try
+    const HRESULT LoopUtil::AddLookbacksFromArray(const array_view<hstring const>& list) const try
+    {
+        return CommitLoopbackChanges(list, true);
+    }
+    catch (...)
     {
-        const IVector<hstring> enabledList = GetEnabledLoopList(list, false);
-        vector<SID_AND_ATTRIBUTES> arr;
-        DWORD count = 0;
+        return to_hresult();
+    }
 
-        for (hstring app : enabledList)
+    const HRESULT LoopUtil::AddLookbacksFromBinary(const array_view<uint8_t const>& sids) const try
+    {
+        return CommitLoopbackChanges(sids, true);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::RemoveLookbacksFromArray(const array_view<hstring const>& list) const try
+    {
+        return CommitLoopbackChanges(list, false);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::RemoveLookbacksFromBinary(const array_view<uint8_t const>& sids) const try
+    {
+        return CommitLoopbackChanges(sids, false);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::AddLookbackByPackageFamilyName(const hstring& familyName) try
+    {
+        const vector<hstring> familyList = GetFamilySids(familyName);
+        if (familyList.empty()) { return HRESULT_FROM_WIN32(ERROR_NOT_FOUND); }
+        return CommitLoopbackChanges(familyList, true);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const HRESULT LoopUtil::RemoveLookbackByPackageFamilyName(const hstring& familyName) try
+    {
+        const vector<hstring> familyList = GetFamilySids(familyName);
+        if (familyList.empty()) { return HRESULT_FROM_WIN32(ERROR_NOT_FOUND); }
+        return CommitLoopbackChanges(familyList, false);
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    const vector<hstring> LoopUtil::GetFamilySids(const hstring& familyName)
+    {
+        const AppContainerSnapshot& index = GetSnapshot();
+        vector<hstring> familyList;
+        for (const uint32_t i : index.FindByPackageFamilyName(familyName))
         {
-            SID_AND_ATTRIBUTES sid{};
-            sid.Attributes = 0;
-            //TO DO:
-            PSID ptr = nullptr;
-            ConvertStringSidToSid(app.c_str(), &ptr);
-            sid.Sid = ptr;
-            arr.push_back(sid);
-            count++;
+            familyList.push_back(index.GetAt(i).AppContainerSid());
         }
+        return familyList;
+    }
+
+    const HRESULT LoopUtil::RollbackExemptions(const uint32_t entry) try
+    {
+        //Entry zero is the configuration before the first commit, which older journals lack.
+        if (entry > ExemptionJournal::Current().Size() || (entry == 0 && !ExemptionJournal::Current().HasBaseline())) { return E_BOUNDS; }
 
-        return NetworkIsolationSetAppContainerConfig(count, arr.data());
+        SidArray enabledList;
+        for (string& sid : ExemptionJournal::Current().GetListAt(entry))
+        {
+            enabledList.Append(static_cast<PSID>(sid.data()));
+        }
+        return CommitConfigList(enabledList);
     }
     catch (...)
     {
         return to_hresult();
     }
 
-    const AppContainer LoopUtil::CreateAppContainer(const INET_FIREWALL_APP_CONTAINER& PI_app, const bool loopUtil) const
+    const uint32_t LoopUtil::ExemptionJournalLength() const
+    {
+        return ExemptionJournal::Current().Size();
+    }
+
+    IVectorView<ExemptionHistoryEntry> LoopUtil::GetExemptionHistory(const hstring& stringSid) const
+    {
+        PSID sid = nullptr;
+        check_bool(ConvertStringSidToSid(stringSid.c_str(), &sid));
+        vector<ExemptionJournalEntry> entries;
+        try
+        {
+            entries = ExemptionJournal::Current().GetHistory(sid);
+        }
+        catch (...)
+        {
+            LocalFree(sid);
+            throw;
+        }
+        LocalFree(sid);
+
+        vector<ExemptionHistoryEntry> history;
+        history.reserve(entries.size());
+        for (const ExemptionJournalEntry& entry : entries)
+        {
+            history.push_back({ entry.Sequence, DateTime{ TimeSpan{ entry.Timestamp } }, entry.IsAdded });
+        }
+        return single_threaded_vector<ExemptionHistoryEntry>(move(history)).GetView();
+    }
+
+    const AppContainer LoopUtil::CreateAppContainer(const INET_FIREWALL_APP_CONTAINER& PI_app, const bool loopUtil, const AppContainerFields fields) const
     {
+        const auto has = [&](const AppContainerFields field) { return (fields & field) == field; };
         AppContainer app = AppContainer::AppContainer();
+        app.Fields(fields);
 
-        app.IsEnableLoop(loopUtil);
-        if (PI_app.displayName) { app.DisplayName(PI_app.displayName); }
-        if (PI_app.description) { app.DisplayName(PI_app.description); }
-        if (PI_app.appContainerName) { app.AppContainerName(PI_app.appContainerName); }
-        if (PI_app.packageFullName) { app.PackageFullName(PI_app.packageFullName); }
-        if (PI_app.workingDirectory) { app.WorkingDirectory(PI_app.workingDirectory); }
+        if (has(AppContainerFields::IsEnableLoop)) { app.IsEnableLoop(loopUtil); }
+        IndirectStringCache& strings = IndirectStringCache::Current();
+        if (PI_app.displayName && has(AppContainerFields::DisplayName)) { app.DisplayName(strings.Resolve(PI_app.displayName)); }
+        if (PI_app.description && has(AppContainerFields::Description)) { app.Description(strings.Resolve(PI_app.description)); }
+        if (PI_app.appContainerName && has(AppContainerFields::AppContainerName)) { app.AppContainerName(PI_app.appContainerName); }
+        if (PI_app.packageFullName && has(AppContainerFields::PackageFullName)) { app.PackageFullName(PI_app.packageFullName); }
+        if (PI_app.workingDirectory && has(AppContainerFields::WorkingDirectory)) { app.WorkingDirectory(PI_app.workingDirectory); }
 
-        if (PI_app.appContainerSid)
+        if (PI_app.appContainerSid && has(AppContainerFields::AppContainerSid))
         {
-            LPWSTR tempSid;
+            LPWSTR tempSid = nullptr;
             ConvertSidToStringSid(PI_app.appContainerSid, &tempSid);
-            if (tempSid) { app.AppContainerSid(tempSid); }
+            if (tempSid)
+            {
+                app.AppContainerSid(tempSid);
+                LocalFree(tempSid);
+            }
         }
 
-        if (PI_app.userSid)
+        if (PI_app.userSid && has(AppContainerFields::UserSid))
         {
-            LPWSTR tempSid;
+            LPWSTR tempSid = nullptr;
             ConvertSidToStringSid(PI_app.userSid, &tempSid);
-            if (tempSid) { app.UserSid(tempSid); }
+            if (tempSid)
+            {
+                app.UserSid(tempSid);
+                LocalFree(tempSid);
+            }
         }
 
-        const IVector<hstring> capabilities = GetCapabilities(PI_app.capabilities);
-        app.Capabilities(capabilities);
+        if (has(AppContainerFields::Capabilities))
+        {
+            const IVector<hstring> capabilities = GetCapabilities(PI_app.capabilities);
+            app.Capabilities(capabilities);
+        }
 
-        const IVector<hstring> app_binaries = GetBinaries(PI_app.binaries);
-        app.Binaries(app_binaries);
+        if (has(AppContainerFields::Binaries))
+        {
+            const IVector<hstring> app_binaries = GetBinaries(PI_app.binaries);
+            app.Binaries(app_binaries);
+        }
 
         return app;
     }
@@ -364,8 +907,15 @@ namespace winrt::LoopBack::Metadata::implementation
         return myCap;
     }
 
+    HINSTANCE LoopUtil::LoadFirewallAPI()
+    {
+        TraceSpan span("LoadFirewallAPI");
+        return LoadLibrary(L"FirewallAPI.dll");
+    }
+
     const IVector<hstring> LoopUtil::PI_NetworkIsolationGetAppContainerConfig() const
     {
+        TraceSpan span("NetworkIsolationGetAppContainerConfig");
         DWORD size = 0;
         PSID_AND_ATTRIBUTES arrayValue = nullptr;
         const IVector<hstring> list = single_threaded_vector<hstring>();
@@ -393,31 +943,92 @@ namespace winrt::LoopBack::Metadata::implementation
         return list;
     }
 
-    const IVectorView<AppContainer> LoopUtil::PI_NetworkIsolationEnumAppContainers(const IVector<AppContainer>& list) const
+    const IVectorView<AppContainer> LoopUtil::PI_NetworkIsolationEnumAppContainers(const IVector<AppContainer>& list, AppContainerSnapshot* index, const AppContainerFields fields) const
     {
         if (!list) { return nullptr; }
         list.Clear();
 
+        PSID scope = nullptr;
+        unordered_set<hstring> configSet;
+        if (!userScope.empty())
+        {
+            check_bool(ConvertStringSidToSid(userScope.c_str(), &scope));
+            if (index && appListConfig)
+            {
+                configSet.insert(begin(appListConfig), end(appListConfig));
+            }
+        }
+
         DWORD size = 0;
         PINET_FIREWALL_APP_CONTAINER arrayValue = nullptr;
+        HRESULT hr;
+        {
+            TraceSpan span("NetworkIsolationEnumAppContainers");
+            hr = NetworkIsolationEnumAppContainers(NETISO_FLAG::NETISO_FLAG_MAX, &size, &arrayValue);
+        }
 
-        if (NetworkIsolationEnumAppContainers(NETISO_FLAG::NETISO_FLAG_MAX, &size, &arrayValue) == S_OK)
+        if (hr == S_OK)
         {
             if (arrayValue)
             {
+                TraceSpan span("ConvertAppContainers");
                 const PINET_FIREWALL_APP_CONTAINER _PACs = arrayValue; //store the pointer so it can be freed when we close the form
 
+                if ((fields & (AppContainerFields::DisplayName | AppContainerFields::Description)) != AppContainerFields::None)
+                {
+                    //Indirect names seen for the first time are resolved together before any container is built.
+                    TraceSpan span("ResolveIndirectStrings");
+                    vector<wstring> references;
+                    for (DWORD i = 0; i < size; i++)
+                    {
+                        const INET_FIREWALL_APP_CONTAINER& cur = arrayValue[i];
+                        if (scope && !(cur.userSid && EqualSid(cur.userSid, scope))) { continue; }
+                        if (cur.displayName && (fields & AppContainerFields::DisplayName) == AppContainerFields::DisplayName && IndirectStringCache::IsIndirect(cur.displayName)) { references.emplace_back(cur.displayName); }
+                        if (cur.description && (fields & AppContainerFields::Description) == AppContainerFields::Description && IndirectStringCache::IsIndirect(cur.description)) { references.emplace_back(cur.description); }
+                    }
+                    IndirectStringCache::Current().Prefetch(references);
+                }
+
                 for (DWORD i = 0; i < size; i++)
                 {
                     const INET_FIREWALL_APP_CONTAINER cur = arrayValue[i];
-                    const AppContainer app = CreateAppContainer(cur, CheckLoopback(cur.appContainerSid));
+                    if (scope && !(cur.userSid && EqualSid(cur.userSid, scope)))
+                    {
+                        //Containers of other users are not materialized, only their exemptions are remembered.
+                        LPWSTR sid = nullptr;
+                        if (cur.appContainerSid && ConvertSidToStringSid(cur.appContainerSid, &sid) && sid)
+                        {
+                            if (index && configSet.contains(sid))
+                            {
+                                index->Preserve(sid);
+                            }
+                            LocalFree(sid);
+                        }
+                        continue;
+                    }
+                    const bool isEnableLoop = (fields & AppContainerFields::IsEnableLoop) == AppContainerFields::IsEnableLoop && CheckLoopback(cur.appContainerSid);
+                    const AppContainer app = CreateAppContainer(cur, isEnableLoop, fields);
                     list.Append(app);
+                    if (index)
+                    {
+                        index->Append(app);
+                    }
                 }
 
                 PI_NetworkIsolationFreeAppContainers(_PACs);
             }
         }
 
+        if (scope)
+        {
+            LocalFree(scope);
+        }
+        if (index)
+        {
+            TraceSpan span("SealSnapshot");
+            index->Seal();
+        }
+
         return list.GetView();
     }
 
@@ -429,91 +1040,262 @@ namespace winrt::LoopBack::Metadata::implementation
         }
     }
 
-    const IVector<hstring> LoopUtil::GetEnabledLoopList(const hstring& sid, const bool isAdd) const
+    template <typename TSource>
+    const HRESULT LoopUtil::CommitLoopbackList(const TSource& source) const
     {
-        const IVector<hstring> enabledList = single_threaded_vector<hstring>();
-        for (AppContainer app : apps)
+        SidArray list;
+        if (!list.AppendAll(source)) { return E_INVALIDARG; }
+        //Exemptions of containers outside the user scope are kept as they are.
+        list.AppendAll(GetPreservedLoopList());
+        return CommitConfigList(list);
+    }
+
+    const vector<hstring> LoopUtil::ValidateSids(const array_view<hstring const>& list, const bool isRemove, vector<ExemptionItemResult>& results)
+    {
+        const AppContainerSnapshot& index = GetSnapshot();
+        const vector<hstring>& preservedList = index.PreservedSids();
+        unordered_set<hstring> knownSet(preservedList.begin(), preservedList.end());
+        //Entries of uninstalled packages can still be removed.
+        if (isRemove && appListConfig)
+        {
+            knownSet.insert(begin(appListConfig), end(appListConfig));
+        }
+
+        vector<hstring> validList;
+        unordered_set<hstring> seenSet;
+        results.reserve(list.size());
+        for (uint32_t i = 0; i < list.size(); i++)
         {
-            if (app.IsEnableLoop())
+            ExemptionItemResult item{ i, list[i], ExemptionItemStatus::Succeeded };
+
+            //Normalize the SID so that differently written forms of one SID are caught as duplicates.
+            PSID ptr = nullptr;
+            LPWSTR stringSid = nullptr;
+            if (!ConvertStringSidToSid(list[i].c_str(), &ptr) || !ptr)
+            {
+                item.Status = ExemptionItemStatus::InvalidSid;
+            }
+            else
             {
-                const hstring stringSid = app.AppContainerSid();
-                if (stringSid != sid)
+                if (ConvertSidToStringSid(ptr, &stringSid) && stringSid)
+                {
+                    item.Sid = stringSid;
+                    LocalFree(stringSid);
+                }
+                LocalFree(ptr);
+
+                if (!seenSet.insert(item.Sid).second)
+                {
+                    item.Status = ExemptionItemStatus::Duplicate;
+                }
+                else if (!index.FindBySid(item.Sid) && !knownSet.contains(item.Sid))
+                {
+                    item.Status = ExemptionItemStatus::UnknownContainer;
+                }
+                else
                 {
-                    enabledList.Append(app.AppContainerSid());
+                    validList.push_back(item.Sid);
                 }
             }
+
+            results.push_back(item);
         }
-        if (isAdd)
-        {
-            enabledList.Append(sid);
-        }
-        return enabledList;
+
+        return validList;
     }
 
-    const IVector<hstring> LoopUtil::GetEnabledLoopList(const IIterable<hstring>& list, const bool isAdd) const
+    const IVectorView<ExemptionItemResult> LoopUtil::CompleteResults(vector<ExemptionItemResult>& results, const HRESULT result, const uint32_t committed)
     {
-        const IVector<hstring> enabledList = single_threaded_vector<hstring>();
-        for (AppContainer app : apps)
+        if (FAILED(result))
         {
-            if (app.IsEnableLoop())
+            //Valid items are committed in order, so the ones before the failed chunk went out.
+            uint32_t valid = 0;
+            for (ExemptionItemResult& item : results)
             {
-                bool found = false;
-                const hstring stringSid = app.AppContainerSid();
-                for (hstring sid : list)
+                if (item.Status == ExemptionItemStatus::Succeeded && valid++ >= committed)
                 {
-                    if (stringSid == sid)
-                    {
-                        found = true;
-                        break;
-                    }
+                    item.Status = ExemptionItemStatus::CommitFailed;
                 }
-                if (!found)
+            }
+        }
+        return single_threaded_vector<ExemptionItemResult>(move(results)).GetView();
+    }
+
+    const HRESULT LoopUtil::CommitConfigList(SidArray& list) const
+    {
+        const HRESULT result = SetAppContainerConfig(list.Size(), list.Data());
+        if (SUCCEEDED(result))
+        {
+            SyncLoopbackList(list.ToStrings());
+            PublishSnapshot();
+        }
+        return result;
+    }
+
+    template <typename TSource>
+    const HRESULT LoopUtil::CommitLoopbackChanges(const TSource& source, const bool isAdd, uint32_t* committed) const
+    {
+        SidArray list;
+        if (!list.AppendAll(source)) { return E_INVALIDARG; }
+        if (list.Size() == 0) { return S_OK; }
+
+        HRESULT result = S_OK;
+        RequestScheduler& scheduler = RequestScheduler::Current();
+        if (list.Size() <= BulkChunkSize)
+        {
+            scheduler.Run(RequestClass::InteractiveWrite, [&]() { result = ApplyLoopbackChanges(list, isAdd); });
+            if (committed && SUCCEEDED(result)) { *committed = list.Size(); }
+            return result;
+        }
+
+        //Large changes go out in chunks, each a read-modify-write of its own, so an interactive
+        //request that arrives meanwhile is committed between two of them.
+        const size_t count = (list.Size() + BulkChunkSize - 1) / BulkChunkSize;
+        scheduler.RunChunked(RequestClass::Bulk, count, [&](const size_t index)
+            {
+                SidArray chunk;
+                const uint32_t last = static_cast<uint32_t>(min<size_t>(list.Size(), (index + 1) * BulkChunkSize));
+                for (uint32_t i = static_cast<uint32_t>(index * BulkChunkSize); i < last; i++)
                 {
-                    enabledList.Append(app.AppContainerSid());
+                    chunk.Append(list.GetAt(i));
                 }
+                result = ApplyLoopbackChanges(chunk, isAdd);
+                if (committed && SUCCEEDED(result)) { *committed = last; }
+                return SUCCEEDED(result);
+            });
+        return result;
+    }
+
+    const HRESULT LoopUtil::ApplyLoopbackChanges(const SidArray& list, const bool isAdd) const
+    {
+        //Every client has its own snapshot, so the change is applied to the live configuration
+        //under the process-wide commit lock rather than to what this instance saw last.
+        const lock_guard<recursive_mutex> guard(commitLock);
+        SidArray enabledList;
+        const DWORD removed = ReadConfigList(enabledList, isAdd ? nullptr : &list);
+        const DWORD count = enabledList.Size();
+        if (isAdd)
+        {
+            for (uint32_t i = 0; i < list.Size(); i++)
+            {
+                enabledList.Append(list.GetAt(i));
             }
         }
-        if (isAdd)
+        //Adding SIDs that are all exempted already, or removing none that are, is not committed.
+        if (isAdd ? enabledList.Size() == count : removed == 0) { return S_OK; }
+        return CommitConfigList(enabledList);
+    }
+
+    const DWORD LoopUtil::ReadConfigList(SidArray& list, const SidArray* excludedList) const
+    {
+        TraceSpan span("NetworkIsolationGetAppContainerConfig");
+        DWORD size = 0;
+        PSID_AND_ATTRIBUTES arrayValue = nullptr;
+        //Committing on top of a configuration that could not be read would drop every exemption.
+        const DWORD error = NetworkIsolationGetAppContainerConfig(&size, &arrayValue);
+        if (error != ERROR_SUCCESS) { throw_hresult(HRESULT_FROM_WIN32(error)); }
+        if (!arrayValue) { return 0; }
+
+        DWORD excluded = 0;
+        for (DWORD i = 0; i < size; i++)
         {
-            for (hstring sid : list)
+            const PSID sid = arrayValue[i].Sid;
+            if (sid && excludedList && excludedList->Contains(sid))
+            {
+                excluded++;
+            }
+            else if (sid)
             {
-                enabledList.Append(sid);
+                list.Append(sid);
             }
+            HeapFree(GetProcessHeap(), 0, sid);
         }
-        return enabledList;
+        HeapFree(GetProcessHeap(), 0, arrayValue);
+        return excluded;
     }
 
-    const IVector<hstring> LoopUtil::GetEnabledLoopList(const IIterable<AppContainer>& list, const bool isAdd) const
+    void LoopUtil::SyncLoopbackList(const vector<hstring>& list) const
     {
-        const IVector<hstring> enabledList = single_threaded_vector<hstring>();
+        //Keep the cached state in line with what was committed.
+        const unordered_set<hstring> enabledSet(list.begin(), list.end());
         for (AppContainer app : apps)
         {
-            if (app.IsEnableLoop())
+            app.IsEnableLoop(enabledSet.contains(app.AppContainerSid()));
+        }
+        if (appListConfig)
+        {
+            appListConfig.ReplaceAll(list);
+        }
+    }
+
+    const HRESULT LoopUtil::SetAppContainerConfig(const DWORD count, const PSID_AND_ATTRIBUTES list) const
+    {
+        //Commits from all clients of this server go out one at a time, in journal order.
+        //The turn is always taken before the lock, so a turn holder never waits on it.
+        HRESULT result = S_OK;
+        RequestScheduler::Current().Run(RequestClass::InteractiveWrite, [&]()
             {
-                bool found = false;
-                const hstring stringSid = app.AppContainerSid();
-                for (AppContainer container : list)
+                const lock_guard<recursive_mutex> guard(commitLock);
+                RecordJournalBaseline();
+                result = HRESULT_FROM_WIN32(NetworkIsolationSetAppContainerConfig(count, list));
+                if (SUCCEEDED(result))
                 {
-                    if (stringSid == container.AppContainerSid())
+                    try
                     {
-                        found = true;
-                        break;
+                        ExemptionJournal::Current().Append(count, list);
+                    }
+                    catch (...)
+                    {
+                        //The commit itself succeeded, a journal that cannot be written must not fail it.
                     }
                 }
-                if (!found)
-                {
-                    enabledList.Append(app.AppContainerSid());
-                }
-            }
+            });
+        return result;
+    }
+
+    void LoopUtil::RecordJournalBaseline() const
+    {
+        try
+        {
+            ExemptionJournal& journal = ExemptionJournal::Current();
+            if (journal.Size() > 0 || journal.HasBaseline()) { return; }
+            //Rolling back to entry zero restores the configuration found before the first commit,
+            //including exemptions made outside this tool.
+            SidArray baseline;
+            ReadConfigList(baseline, nullptr);
+            journal.SetBaseline(baseline.Size(), baseline.Data());
         }
-        if (isAdd)
+        catch (...)
         {
-            for (AppContainer container : list)
-            {
-                enabledList.Append(container.AppContainerSid());
-            }
+            //Without a baseline entry zero cannot be rolled back to, the commit still goes ahead.
         }
-        return enabledList;
+    }
+
+    const AppContainerSnapshot& LoopUtil::GetSnapshot()
+    {
+        //A scope without containers has an empty snapshot, which is not enumerated again on every call.
+        if (!snapshot)
+        {
+            GetAppContainers();
+        }
+        return *snapshot;
+    }
+
+    const vector<hstring>& LoopUtil::GetPreservedLoopList() const
+    {
+        static const vector<hstring> empty;
+        return snapshot ? snapshot->PreservedSids() : empty;
+    }
+
+    const IVectorView<AppContainer> LoopUtil::GetAppContainersAt(const vector<uint32_t>& indices) const
+    {
+        vector<AppContainer> result;
+        result.reserve(indices.size());
+        for (const uint32_t i : indices)
+        {
+            result.push_back(snapshot->GetAt(i));
+        }
+        return single_threaded_vector<AppContainer>(move(result)).GetView();
     }
 
     void LoopUtil::Close()
@@ -524,7 +1306,12 @@ namespace winrt::LoopBack::Metadata::implementation
             firewallAPI = nullptr;
         }
         apps.Clear();
-        appListConfig.Clear();
+        if (appListConfig)
+        {
+            appListConfig.Clear();
+        }
         appListConfig = nullptr;
+        snapshot = nullptr;
+        pendingBuild = nullptr;
     }
 }
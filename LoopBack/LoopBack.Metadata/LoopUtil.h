@@ -1,6 +1,11 @@
 ﻿#pragma once
 
 #include "LoopUtil.g.h"
+#include "AppContainerSnapshot.h"
+#include "ExemptionRuleEngine.h"
+#include "SidArray.h"
+#include "SupervisedCall.h"
+#include <memory>
 
 using namespace winrt;
 using namespace LoopBack::Metadata;
@@ -30,7 +35,22 @@ namespace winrt::LoopBack::Metadata::implementation
             return apps.GetView();
         }
 
+        hstring UserScope() const { return userScope; }
+        void UserScope(const hstring& value) { userScope = value; }
+
+        TimeSpan BackendTimeout() const { return backendTimeout; }
+        void BackendTimeout(const TimeSpan& value) { backendTimeout = value; }
+        const bool IsStale() const { return isStale; }
+
         IVectorView<AppContainer> GetAppContainers();
+        IVectorView<AppContainer> GetAppContainersWithFields(const AppContainerFields& fields);
+        const uint64_t ETag() const { return snapshot ? snapshot->ETag() : 0; }
+        IVectorView<AppContainer> GetAppContainersIfModified(const uint64_t etag);
+        IVectorView<AppContainerChange> GetAppContainerChanges();
+        IVectorView<AppContainer> GetAppContainersForUser(const hstring& userSid);
+        IVectorView<AppContainer> GetSortedAppContainers(const AppContainerSortColumn& column, const bool ascending, const hstring& filter);
+        SnapshotSectionHandles ShareSnapshotSection();
+        const HRESULT ExportAppContainers(const hstring& path, const AppContainerExportFormat& format) const;
         const HRESULT SetLoopbackList(const IIterable<hstring>& list) const;
         const HRESULT SetLoopbackList(const IIterable<AppContainer>& list) const;
         const HRESULT AddLookback(const hstring& stringSid) const;
@@ -41,23 +61,113 @@ namespace winrt::LoopBack::Metadata::implementation
         const HRESULT RemoveLookback(const AppContainer& appContainer) const;
         const HRESULT RemoveLookbacks(const IIterable<hstring>& list) const;
         const HRESULT RemoveLookbacks(const IIterable<AppContainer>& list) const;
+        const HRESULT SetLoopbackListFromArray(const array_view<hstring const>& list) const;
+        const HRESULT SetLoopbackListFromBinary(const array_view<uint8_t const>& sids) const;
+        const HRESULT AddLookbacksFromArray(const array_view<hstring const>& list) const;
+        const HRESULT AddLookbacksFromBinary(const array_view<uint8_t const>& sids) const;
+        const HRESULT RemoveLookbacksFromArray(const array_view<hstring const>& list) const;
+        const HRESULT RemoveLookbacksFromBinary(const array_view<uint8_t const>& sids) const;
+        IVectorView<ExemptionItemResult> SetLoopbackListWithResults(const array_view<hstring const>& list);
+        IVectorView<ExemptionItemResult> AddLookbacksWithResults(const array_view<hstring const>& list);
+        IVectorView<ExemptionItemResult> RemoveLookbacksWithResults(const array_view<hstring const>& list);
+        const HRESULT AddTemporaryLookback(const AppContainer& appContainer, const TimeSpan& duration) const;
+        const HRESULT AddTemporaryLookbackBySid(const hstring& stringSid, const TimeSpan& duration) const;
+        IReference<DateTime> GetLookbackExpiry(const hstring& stringSid) const;
+        const HRESULT ApplyExemptionRules(const IIterable<ExemptionRule>& rules);
+        AppContainer FindBySid(const hstring& stringSid);
+        IVectorView<AppContainer> FindByPackageFamilyName(const hstring& familyName);
+        IVectorView<AppContainer> FindByPublisherId(const hstring& publisherId);
+        AppContainer FindByPath(const hstring& path);
+        IVectorView<AppContainer> QueryByCapabilities(const IIterable<hstring>& allOf, const IIterable<hstring>& anyOf, const IIterable<hstring>& noneOf, const IReference<bool>& isEnableLoop);
+        const HRESULT AddLookbackByPackageFamilyName(const hstring& familyName);
+        const HRESULT RemoveLookbackByPackageFamilyName(const hstring& familyName);
+        LoopBack::Metadata::ExemptionAuditReport AuditExemptions();
+        const HRESULT CompactExemptions();
+        const HRESULT RollbackExemptions(const uint32_t entry);
+        const uint32_t ExemptionJournalLength() const;
+        IVectorView<ExemptionHistoryEntry> GetExemptionHistory(const hstring& stringSid) const;
         void Close();
 
+        // Starts building a snapshot in the background so the first client finds it ready.
+        static void StartWarmup();
+
+        // Removes expired SIDs from the current configuration in a single commit.
+        const HRESULT RemoveExpiredLookbacks(const std::vector<hstring>& list);
+
     private:
+        using BuildCall = SupervisedCall<com_ptr<LoopUtil>>;
+
+        // Number of SIDs a bulk change commits per turn at the backend.
+        static constexpr size_t BulkChunkSize = 64;
+        // Projections are served from a snapshot no older than this instead of a new enumeration.
+        static constexpr std::chrono::seconds SnapshotFreshness = std::chrono::seconds(5);
+
         const IVector<AppContainer> apps = single_threaded_vector<AppContainer>();
         IVector<hstring> appListConfig = nullptr;
-        HINSTANCE firewallAPI = LoadLibrary(L"FirewallAPI.dll");
+        std::shared_ptr<AppContainerSnapshot> snapshot = nullptr;
+        std::chrono::steady_clock::time_point snapshotTime;
+        hstring userScope = L"";
+        TimeSpan backendTimeout = std::chrono::seconds(10);
+        bool isStale = false;
+        std::shared_ptr<BuildCall> pendingBuild = nullptr;
+        HINSTANCE firewallAPI = LoadFirewallAPI();
+        ExemptionRuleEngine ruleEngine;
+        std::shared_ptr<const ExemptionRuleList> compiledRules = nullptr;
+
+        inline static std::recursive_mutex commitLock;
+        inline static std::mutex warmupLock;
+        inline static std::shared_ptr<BuildCall> warmupBuild = nullptr;
+        inline static std::chrono::steady_clock::time_point warmupStarted;
 
-        const AppContainer CreateAppContainer(const INET_FIREWALL_APP_CONTAINER& PI_app, const bool loopUtil) const;
+        static HINSTANCE LoadFirewallAPI();
+        static std::shared_ptr<BuildCall> StartBuild(const hstring& scope, const RequestClass requestClass, const AppContainerFields fields = AppContainerFields::All);
+        static std::shared_ptr<BuildCall> TakeWarmup();
+        // Builds the containers of the user scope with every field into a new snapshot, or only
+        // the requested fields into a plain list.
+        void EnumerateAppContainers(const AppContainerFields fields = AppContainerFields::All);
+        // Joins or starts an enumeration and takes its result. Returns false, keeping the last
+        // snapshot as stale, when the backend does not answer in time.
+        const bool LoadAppContainers();
+        void PublishSnapshot() const;
+        const bool RestoreIfUnchanged(const std::shared_ptr<AppContainerSnapshot>& previous);
+        const AppContainer CreateAppContainer(const INET_FIREWALL_APP_CONTAINER& PI_app, const bool loopUtil, const AppContainerFields fields = AppContainerFields::All) const;
         const bool CheckLoopback(SID* intPtr) const;
         const IVector<hstring> GetBinaries(const INET_FIREWALL_AC_BINARIES& cap) const;
         const IVector<hstring> GetCapabilities(const INET_FIREWALL_AC_CAPABILITIES& cap) const;
         const IVector<hstring> PI_NetworkIsolationGetAppContainerConfig() const;
-        const IVectorView<AppContainer> PI_NetworkIsolationEnumAppContainers(const IVector<AppContainer>& list) const;
+        const IVectorView<AppContainer> PI_NetworkIsolationEnumAppContainers(const IVector<AppContainer>& list, AppContainerSnapshot* index, const AppContainerFields fields = AppContainerFields::All) const;
         void PI_NetworkIsolationFreeAppContainers(const PINET_FIREWALL_APP_CONTAINER& point) const;
-        const IVector<hstring> GetEnabledLoopList(const hstring& list, const bool isAdd = true) const;
-        const IVector<hstring> GetEnabledLoopList(const IIterable<hstring>& list, const bool isAdd = true) const;
-        const IVector<hstring> GetEnabledLoopList(const IIterable<AppContainer>& list, const bool isAdd = true) const;
+        // Replaces the configuration with the SIDs of source and the preserved exemptions.
+        template <typename TSource>
+        const HRESULT CommitLoopbackList(const TSource& source) const;
+        const std::vector<hstring> ValidateSids(const array_view<hstring const>& list, const bool isRemove, std::vector<ExemptionItemResult>& results);
+        // Marks the valid items after the first committed ones as failed when result is a failure.
+        static const IVectorView<ExemptionItemResult> CompleteResults(std::vector<ExemptionItemResult>& results, const HRESULT result, const uint32_t committed = 0);
+        const HRESULT CommitConfigList(SidArray& list) const;
+        void AuditConfigList(const AppContainerSnapshot& index, const IVector<hstring>& configList, std::vector<hstring>* keptList, std::vector<hstring>* orphanedList, std::vector<hstring>* duplicateList);
+        const std::vector<hstring> GetFamilySids(const hstring& familyName);
+        // Adds or removes the SIDs of source with a read-modify-write of the live configuration.
+        // A change of more than BulkChunkSize SIDs is committed in chunks, and committed is set
+        // to how many leading SIDs went out when a later chunk fails.
+        template <typename TSource>
+        const HRESULT CommitLoopbackChanges(const TSource& source, const bool isAdd, uint32_t* committed = nullptr) const;
+        const HRESULT ApplyLoopbackChanges(const SidArray& list, const bool isAdd) const;
+        // Exempts the containers of the snapshot that rules match and that are not exempt yet.
+        // Once the commit succeeded, matches changes does not report yet are appended to it.
+        const HRESULT ApplyRules(const std::shared_ptr<const ExemptionRuleList>& rules, std::vector<LoopBack::Metadata::AppContainerChange>* changes);
+        // Applies the rule set of the process after an enumeration. A failure is left to the
+        // next enumeration rather than failing this one.
+        void ApplyStoredRules(std::vector<LoopBack::Metadata::AppContainerChange>* changes);
+        // Appends the live configuration except excludedList, and returns how many SIDs it left out.
+        const DWORD ReadConfigList(SidArray& list, const SidArray* excludedList) const;
+        void SyncLoopbackList(const std::vector<hstring>& list) const;
+        const HRESULT SetAppContainerConfig(const DWORD count, const PSID_AND_ATTRIBUTES list) const;
+        // Records the live configuration in the journal before its first commit.
+        void RecordJournalBaseline() const;
+        const AppContainerSnapshot& GetSnapshot();
+        const std::vector<hstring>& GetPreservedLoopList() const;
+        static const AppContainer ProjectAppContainer(const AppContainer& app, const AppContainerFields& fields);
+        const IVectorView<AppContainer> GetAppContainersAt(const std::vector<uint32_t>& indices) const;
 
         const decltype(&NetworkIsolationGetAppContainerConfig) NetworkIsolationGetAppContainerConfig = GetNetworkIsolationGetAppContainerConfig();
         const decltype(&NetworkIsolationSetAppContainerConfig) NetworkIsolationSetAppContainerConfig = GetNetworkIsolationSetAppContainerConfig();
@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "PathTrie.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    template <typename TCallback>
+    void PathTrie::ForEachSegment(wstring_view path, TCallback&& callback)
+    {
+        //Long path and device prefixes do not take part in the match.
+        if (path.starts_with(L"\\\\?\\") || path.starts_with(L"\\\\.\\"))
+        {
+            path.remove_prefix(4);
+        }
+
+        size_t start = 0;
+        while (start < path.size())
+        {
+            const size_t end = path.find_first_of(L"\\/", start);
+            const wstring_view segment = path.substr(start, end == wstring_view::npos ? wstring_view::npos : end - start);
+            if (!segment.empty() && segment != L"." && !callback(segment))
+            {
+                return;
+            }
+            if (end == wstring_view::npos) { break; }
+            start = end + 1;
+        }
+    }
+
+    void PathTrie::Insert(const wstring_view path, const uint32_t owner)
+    {
+        const wstring folded = FoldCase(path);
+        uint32_t current = 0;
+        bool hasSegment = false;
+
+        ForEachSegment(folded, [&](const wstring_view segment)
+            {
+                hasSegment = true;
+                const auto child = nodes[current].children.find(segment);
+                if (child != nodes[current].children.end())
+                {
+                    current = child->second;
+                    return true;
+                }
+                const uint32_t next = static_cast<uint32_t>(nodes.size());
+                nodes[current].children.emplace(segment, next);
+                nodes.emplace_back();
+                current = next;
+                return true;
+            });
+
+        //The first container that claims a path keeps it.
+        if (hasSegment && nodes[current].owner == NoOwner)
+        {
+            nodes[current].owner = owner;
+        }
+    }
+
+    const uint32_t PathTrie::FindLongestPrefix(const wstring_view path) const
+    {
+        const wstring folded = FoldCase(path);
+        uint32_t current = 0;
+        uint32_t owner = NoOwner;
+
+        ForEachSegment(folded, [&](const wstring_view segment)
+            {
+                const auto child = nodes[current].children.find(segment);
+                if (child == nodes[current].children.end())
+                {
+                    return false;
+                }
+                current = child->second;
+                if (nodes[current].owner != NoOwner)
+                {
+                    owner = nodes[current].owner;
+                }
+                return true;
+            });
+
+        return owner;
+    }
+}
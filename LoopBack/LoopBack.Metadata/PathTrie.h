@@ -0,0 +1,38 @@
+#pragma once
+
+#include "StringHelpers.h"
+#include <unordered_map>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Maps file system paths to owners one path segment at a time, so the owner of a
+    // file is found by walking the segments of its path and keeping the deepest match.
+    struct PathTrie
+    {
+        static constexpr uint32_t NoOwner = UINT32_MAX;
+
+        PathTrie() : nodes(1) {}
+
+        void Insert(const std::wstring_view path, const uint32_t owner);
+        const uint32_t FindLongestPrefix(const std::wstring_view path) const;
+
+    private:
+        struct SegmentHash
+        {
+            using is_transparent = void;
+            const size_t operator()(const std::wstring_view value) const { return std::hash<std::wstring_view>{}(value); }
+        };
+
+        struct Node
+        {
+            std::unordered_map<std::wstring, uint32_t, SegmentHash, std::equal_to<>> children;
+            uint32_t owner = NoOwner;
+        };
+
+        std::vector<Node> nodes;
+
+        template <typename TCallback>
+        static void ForEachSegment(const std::wstring_view path, TCallback&& callback);
+    };
+}
@@ -0,0 +1,76 @@
+#include "ProgressThrottle.h"
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    const bool ProgressThrottle::Offer(const uint64_t completed, const uint64_t total, const uint64_t now)
+    {
+        if (hasSent && completed == sentCompleted && total == sentTotal)
+        {
+            hasPending = false;
+            return false;
+        }
+
+        //The final value is never held back, whatever was sent just before it.
+        if (total && completed >= total)
+        {
+            MarkSent(completed, total, now);
+            return true;
+        }
+
+        if (hasSent && GetPercent(completed, total) == sentPercent)
+        {
+            hasPending = false;
+            return false;
+        }
+
+        if (hasSent && now - lastSent < minInterval)
+        {
+            pendingCompleted = completed;
+            pendingTotal = total;
+            hasPending = true;
+            return false;
+        }
+
+        MarkSent(completed, total, now);
+        return true;
+    }
+
+    const bool ProgressThrottle::GetPendingDue(uint64_t& due) const
+    {
+        if (!hasPending) { return false; }
+        due = lastSent + minInterval;
+        return true;
+    }
+
+    const bool ProgressThrottle::TakePending(uint64_t& completed, uint64_t& total, const uint64_t now)
+    {
+        if (!hasPending) { return false; }
+        completed = pendingCompleted;
+        total = pendingTotal;
+        MarkSent(completed, total, now);
+        return true;
+    }
+
+    void ProgressThrottle::Reset()
+    {
+        hasSent = false;
+        hasPending = false;
+    }
+
+    const uint32_t ProgressThrottle::GetPercent(const uint64_t completed, const uint64_t total)
+    {
+        if (!total) { return 0; }
+        //Split the division so large totals cannot overflow the multiplication.
+        return static_cast<uint32_t>(completed >= total ? 100 : completed / total * 100 + completed % total * 100 / total);
+    }
+
+    void ProgressThrottle::MarkSent(const uint64_t completed, const uint64_t total, const uint64_t now)
+    {
+        lastSent = now;
+        sentCompleted = completed;
+        sentTotal = total;
+        sentPercent = GetPercent(completed, total);
+        hasSent = true;
+        hasPending = false;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Decides which progress values are worth sending. A value that shows the same percentage
+    // as the last one sent is dropped, one that arrives within the minimum interval is held
+    // back until it is due or flushed, and the final value always goes out. The caller passes
+    // the time in, so the decisions do not depend on any clock.
+    struct ProgressThrottle
+    {
+        explicit ProgressThrottle(const uint64_t minInterval = 0) : minInterval(minInterval) {}
+
+        const uint64_t MinInterval() const { return minInterval; }
+        void MinInterval(const uint64_t value) { minInterval = value; }
+
+        // Returns whether the value should be sent now.
+        const bool Offer(const uint64_t completed, const uint64_t total, const uint64_t now);
+        // Gets when the value held back may go out, if there is one.
+        const bool GetPendingDue(uint64_t& due) const;
+        // Takes the latest value held back since the last one sent, if there is one.
+        const bool TakePending(uint64_t& completed, uint64_t& total, const uint64_t now);
+        // Forgets the last value sent, so the next one goes out whatever it shows.
+        void Reset();
+
+    private:
+        uint64_t minInterval;
+        uint64_t lastSent = 0;
+        uint64_t sentCompleted = 0;
+        uint64_t sentTotal = 0;
+        uint32_t sentPercent = 0;
+        bool hasSent = false;
+        uint64_t pendingCompleted = 0;
+        uint64_t pendingTotal = 0;
+        bool hasPending = false;
+
+        static const uint32_t GetPercent(const uint64_t completed, const uint64_t total);
+        void MarkSent(const uint64_t completed, const uint64_t total, const uint64_t now);
+    };
+}
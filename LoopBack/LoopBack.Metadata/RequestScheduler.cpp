@@ -0,0 +1,150 @@
+#include "RequestScheduler.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    RequestScheduler& RequestScheduler::Current()
+    {
+        static RequestScheduler scheduler(SteadyClock, 2000);
+        return scheduler;
+    }
+
+    RequestScheduler::RequestScheduler(Clock clock, const uint64_t agingInterval) : clock(move(clock)), agingInterval(agingInterval)
+    {
+    }
+
+    void RequestScheduler::RunAt(const size_t requestClass, const function<void()>& work)
+    {
+        if (hasTurn)
+        {
+            work();
+            return;
+        }
+
+        Acquire(requestClass);
+        try
+        {
+            work();
+        }
+        catch (...)
+        {
+            Release();
+            throw;
+        }
+        Release();
+    }
+
+    void RequestScheduler::AdmitAt(const size_t requestClass)
+    {
+        if (hasTurn) { return; }
+        Acquire(requestClass);
+        Release();
+    }
+
+    void RequestScheduler::RunChunkedAt(const size_t requestClass, const size_t count, const function<bool(const size_t)>& chunk)
+    {
+        if (hasTurn)
+        {
+            for (size_t i = 0; i < count && chunk(i); i++) {}
+            return;
+        }
+
+        Request request = Acquire(requestClass);
+        try
+        {
+            for (size_t i = 0; i < count && chunk(i); i++)
+            {
+                if (i + 1 < count)
+                {
+                    Yield(request);
+                }
+            }
+        }
+        catch (...)
+        {
+            Release();
+            throw;
+        }
+        Release();
+    }
+
+    const array<RequestScheduler::ClassMetrics, RequestScheduler::ClassCount> RequestScheduler::GetMetrics()
+    {
+        const lock_guard<mutex> guard(lock);
+        return metrics;
+    }
+
+    const uint64_t RequestScheduler::SteadyClock()
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    RequestScheduler::Request RequestScheduler::Acquire(const size_t requestClass)
+    {
+        unique_lock<mutex> guard(lock);
+        const uint64_t now = clock();
+        Request request{ nextId++, requestClass * agingInterval + now, now, requestClass, false };
+        waiting.push_back(&request);
+        metrics[requestClass].QueueDepth++;
+        Dispatch();
+        granted.wait(guard, [&]() { return request.IsGranted; });
+        hasTurn = true;
+        return request;
+    }
+
+    void RequestScheduler::Yield(Request& request)
+    {
+        unique_lock<mutex> guard(lock);
+        //Only requests that would have gone before the job had it still been waiting get in.
+        if (none_of(waiting.begin(), waiting.end(), [&](const Request* item) { return IsBefore(*item, request); })) { return; }
+
+        //The job queues again with its old key and id, and the time waited from now on is counted.
+        request.Queued = clock();
+        request.IsGranted = false;
+        waiting.push_back(&request);
+        metrics[request.Class].QueueDepth++;
+        hasTurn = false;
+        isBusy = false;
+        Dispatch();
+        granted.wait(guard, [&]() { return request.IsGranted; });
+        hasTurn = true;
+    }
+
+    void RequestScheduler::Release()
+    {
+        const lock_guard<mutex> guard(lock);
+        hasTurn = false;
+        isBusy = false;
+        metrics[runningClass].Completed++;
+        Dispatch();
+    }
+
+    void RequestScheduler::Dispatch()
+    {
+        if (isBusy || waiting.empty()) { return; }
+
+        const auto next = min_element(waiting.begin(), waiting.end(), [](const Request* left, const Request* right) { return IsBefore(*left, *right); });
+        Request* const request = *next;
+        waiting.erase(next);
+
+        ClassMetrics& item = metrics[request->Class];
+        const uint64_t wait = clock() - request->Queued;
+        item.QueueDepth--;
+        item.TotalWait += wait;
+        item.MaxWait = max(item.MaxWait, wait);
+
+        isBusy = true;
+        runningClass = request->Class;
+        request->IsGranted = true;
+        granted.notify_all();
+    }
+
+    const bool RequestScheduler::IsBefore(const Request& left, const Request& right)
+    {
+        //Lowest key first, and the earlier request among equal keys.
+        return left.Key != right.Key ? left.Key < right.Key : left.Id < right.Id;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Hands out one turn at a time at the backend to requests of every client of the server.
+    // A waiting request is ordered by its class rank times the aging interval plus the time it
+    // was queued, so a higher class goes first but any request that waited long enough beats
+    // one that just arrived. A chunked job offers its turn between chunks to any request that
+    // ranks before it, so an interactive toggle waits for one chunk of a bulk change at most.
+    // Only commits hold a turn while they run; enumerations are admitted and then left to their
+    // supervised worker and its deadline. Time comes from a replaceable clock, and classes are plain ranks, so
+    // the scheduler does not depend on the Windows SDK.
+    struct RequestScheduler
+    {
+        // Gets the time in milliseconds.
+        using Clock = std::function<uint64_t()>;
+
+        static constexpr size_t ClassCount = 4;
+
+        // Counters of one class, with waits in clock milliseconds.
+        struct ClassMetrics
+        {
+            uint32_t QueueDepth = 0;
+            uint64_t Completed = 0;
+            uint64_t TotalWait = 0;
+            uint64_t MaxWait = 0;
+        };
+
+        static RequestScheduler& Current();
+
+        RequestScheduler(Clock clock, const uint64_t agingInterval);
+
+        // Runs work once it gets its turn. A thread that already holds a turn runs it inline.
+        // The class is any enum whose values are the ranks below ClassCount, such as RequestClass.
+        template <typename TClass>
+        void Run(const TClass requestClass, const std::function<void()>& work) { RunAt(static_cast<size_t>(requestClass), work); }
+        // Waits for a turn and hands it straight back. Reads are admitted in priority order this
+        // way but run without the turn, so a hung read that was abandoned never holds up a commit.
+        template <typename TClass>
+        void Admit(const TClass requestClass) { AdmitAt(static_cast<size_t>(requestClass)); }
+        // Runs count chunks of one job, stopping at the first chunk that returns false. Between
+        // chunks the turn goes to the requests that rank before the job, which then resumes
+        // with the key it was first queued with, so it does not lose its aging. Nested in a
+        // turn, the chunks run inline without yielding.
+        template <typename TClass>
+        void RunChunked(const TClass requestClass, const size_t count, const std::function<bool(const size_t)>& chunk) { RunChunkedAt(static_cast<size_t>(requestClass), count, chunk); }
+
+        const std::array<ClassMetrics, ClassCount> GetMetrics();
+
+    private:
+        struct Request
+        {
+            uint64_t Id;
+            uint64_t Key;
+            uint64_t Queued;
+            size_t Class;
+            bool IsGranted;
+        };
+
+        std::mutex lock;
+        std::condition_variable granted;
+        Clock clock;
+        uint64_t agingInterval;
+        std::vector<Request*> waiting;
+        std::array<ClassMetrics, ClassCount> metrics;
+        uint64_t nextId = 0;
+        size_t runningClass = 0;
+        bool isBusy = false;
+
+        inline static thread_local bool hasTurn = false;
+
+        static const uint64_t SteadyClock();
+        void RunAt(const size_t requestClass, const std::function<void()>& work);
+        void AdmitAt(const size_t requestClass);
+        void RunChunkedAt(const size_t requestClass, const size_t count, const std::function<bool(const size_t)>& chunk);
+        Request Acquire(const size_t requestClass);
+        void Yield(Request& request);
+        void Release();
+        void Dispatch();
+        static const bool IsBefore(const Request& left, const Request& right);
+    };
+}
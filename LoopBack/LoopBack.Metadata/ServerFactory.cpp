@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "ServerFactory.h"
 #include "ServerFactory.g.cpp"
+#include "ExemptionExpiry.h"
+#include "LoopUtil.h"
+#include "SpanTracer.h"
 
 using namespace std::chrono;
 
@@ -8,17 +11,39 @@ namespace winrt::LoopBack::Metadata::implementation
 {
     void ServerFactory::StartServer()
     {
-        init_apartment();
+        const std::wstring tracePath = SpanTracer::GetEnvironmentPath();
+        SpanTracer::IsEnabled(!tracePath.empty());
 
-        // Enable fast rundown of objects so that the server exits faster when clients go away.
+        DWORD token = 0;
         {
-            com_ptr<IGlobalOptions> globalOptions;
-            check_hresult(CoCreateInstance(CLSID_GlobalOptions, nullptr, CLSCTX_INPROC, IID_PPV_ARGS(&globalOptions)));
-            check_hresult(globalOptions->Set(COMGLB_RO_SETTINGS, COMGLB_FAST_RUNDOWN));
+            TraceSpan span("StartServer");
+            init_apartment();
+
+            // Enable fast rundown of objects so that the server exits faster when clients go away.
+            {
+                com_ptr<IGlobalOptions> globalOptions;
+                check_hresult(CoCreateInstance(CLSID_GlobalOptions, nullptr, CLSCTX_INPROC, IID_PPV_ARGS(&globalOptions)));
+                check_hresult(globalOptions->Set(COMGLB_RO_SETTINGS, COMGLB_FAST_RUNDOWN));
+            }
+
+            _comServerExitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+            token = RegisterServerManager();
         }
 
-        _comServerExitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-        DWORD token = RegisterServerManager();
+        // The server is almost always started to enumerate, so the first client attaches to this build.
+        LoopUtil::StartWarmup();
+
+        // Resume temporary exemptions left pending by a previous run of the elevated server.
+        if (Factory::IsRunAsAdministrator())
+        {
+            try
+            {
+                ExemptionExpiry::Current();
+            }
+            catch (...)
+            {
+            }
+        }
 
         CheckComRefAsync();
         if (_comServerExitEvent)
@@ -27,6 +52,19 @@ namespace winrt::LoopBack::Metadata::implementation
         }
 
         check_hresult(CoRevokeClassObject(token));
+
+        //Written while COM is still up, and a trace that cannot be written must not fail the shutdown.
+        if (!tracePath.empty())
+        {
+            try
+            {
+                SpanTracer::Export(tracePath);
+            }
+            catch (...)
+            {
+            }
+        }
+
         uninit_apartment();
     }
 
@@ -42,6 +80,7 @@ namespace winrt::LoopBack::Metadata::implementation
 
     DWORD ServerFactory::RegisterServerManager()
     {
+        TraceSpan span("RegisterServerManager");
         DWORD registration = 0;
 
         check_hresult(CoRegisterClassObject(
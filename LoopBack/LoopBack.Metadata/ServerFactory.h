@@ -36,7 +36,6 @@ namespace winrt::LoopBack::Metadata::implementation
         HRESULT STDMETHODCALLTYPE CreateInstance(::IUnknown* pUnkOuter, REFIID riid, void** ppvObject);
         HRESULT STDMETHODCALLTYPE LockServer(BOOL fLock);
 
-    private:
         static const bool IsRunAsAdministrator();
     };
 }
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "ServerManager.h"
 #include "ServerManager.g.cpp"
+#include "RequestScheduler.h"
+#include "SpanTracer.h"
 
 using namespace std::chrono;
 
@@ -50,6 +52,7 @@ namespace winrt::LoopBack::Metadata::implementation
 
     LoopUtil ServerManager::GetLoopUtil() const
     {
+        TraceSpan span("GetLoopUtil");
         return LoopUtil::LoopUtil();
     }
 
@@ -83,6 +86,8 @@ namespace winrt::LoopBack::Metadata::implementation
 
     IAsyncOperation<LoopBack::Metadata::ServerManager> ServerManager::GetAdminServerManagerAsync()
     {
+        //The span lives in the coroutine frame, so it also covers the wait for the elevated server.
+        TraceSpan span("GetAdminServerManagerAsync");
         try
         {
             if (m_adminServerManager && m_adminServerManager.IsServerRunning())
@@ -123,6 +128,40 @@ namespace winrt::LoopBack::Metadata::implementation
         }
     }
 
+    const bool ServerManager::IsTracingEnabled() const
+    {
+        return SpanTracer::IsEnabled();
+    }
+
+    void ServerManager::IsTracingEnabled(const bool value) const
+    {
+        SpanTracer::IsEnabled(value);
+    }
+
+    void ServerManager::ExportTrace(const hstring& path) const
+    {
+        SpanTracer::Export(path);
+    }
+
+    IVectorView<RequestClassMetrics> ServerManager::GetSchedulerMetrics() const
+    {
+        const auto metrics = RequestScheduler::Current().GetMetrics();
+        std::vector<RequestClassMetrics> results;
+        for (size_t i = 0; i < metrics.size(); i++)
+        {
+            const RequestScheduler::ClassMetrics& item = metrics[i];
+            results.push_back(
+                {
+                    static_cast<RequestClass>(i),
+                    item.QueueDepth,
+                    item.Completed,
+                    duration_cast<TimeSpan>(milliseconds(item.TotalWait)),
+                    duration_cast<TimeSpan>(milliseconds(item.MaxWait))
+                });
+        }
+        return single_threaded_vector<RequestClassMetrics>(std::move(results)).GetView();
+    }
+
     TaskbarList ServerManager::GetTaskbarList() const
     {
         return TaskbarList::TaskbarList();
@@ -25,6 +25,10 @@ namespace winrt::LoopBack::Metadata::implementation
         IAsyncAction StopServerAsync() const;
         IAsyncOperation<LoopBack::Metadata::ServerManager> GetAdminServerManagerAsync();
         LoopBack::Metadata::TaskbarList GetTaskbarList() const;
+        const bool IsTracingEnabled() const;
+        void IsTracingEnabled(const bool value) const;
+        void ExportTrace(const hstring& path) const;
+        IVectorView<RequestClassMetrics> GetSchedulerMetrics() const;
         void Close();
 
     private:
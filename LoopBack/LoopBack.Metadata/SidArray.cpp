@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "SidArray.h"
+#include "AppContainer.h"
+#include "StringSid.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    static_assert(MaxSidSize == SECURITY_MAX_SID_SIZE);
+
+    SidArray::SidArray() : keys(16, KeyHash{ this }, KeyEqual{ this })
+    {
+    }
+
+    const bool SidArray::Append(const PSID sid)
+    {
+        if (!sid || !IsValidSid(sid)) { return false; }
+        const uint32_t offset = static_cast<uint32_t>(bytes.size());
+        const uint32_t length = GetLengthSid(sid);
+        bytes.insert(bytes.end(), static_cast<const uint8_t*>(sid), static_cast<const uint8_t*>(sid) + length);
+        offsets.push_back(offset);
+        if (!keys.insert(static_cast<uint32_t>(offsets.size() - 1)).second)
+        {
+            offsets.pop_back();
+            bytes.resize(offset);
+        }
+        return true;
+    }
+
+    const bool SidArray::Append(const wstring_view stringSid)
+    {
+        uint8_t buffer[MaxSidSize];
+        if (ParseStringSid(stringSid, buffer))
+        {
+            return Append(static_cast<PSID>(buffer));
+        }
+
+        //Anything else, such as an SDDL alias, goes through the system parser.
+        PSID sid = nullptr;
+        const wstring value(stringSid);
+        if (!ConvertStringSidToSid(value.c_str(), &sid) || !sid) { return false; }
+        const bool result = Append(sid);
+        LocalFree(sid);
+        return result;
+    }
+
+    const bool SidArray::Append(const LoopBack::Metadata::AppContainer& app, bool& isLocal)
+    {
+        //Containers of this process hand over their SID without a call through the projection.
+        if (isLocal)
+        {
+            if (const com_ptr<IAppContainerNative> native = app.try_as<IAppContainerNative>())
+            {
+                PCWSTR value = nullptr;
+                UINT32 length = 0;
+                check_hresult(native->GetAppContainerSid(&value, &length));
+                return Append(wstring_view(value, length));
+            }
+            isLocal = false;
+        }
+        return Append(wstring_view(app.AppContainerSid()));
+    }
+
+    void SidArray::AppendPacked(const array_view<uint8_t const>& sids)
+    {
+        uint32_t offset = 0;
+        while (offset < sids.size())
+        {
+            //The fixed part of a SID is 8 bytes and holds the number of 4 byte sub-authorities.
+            if (sids.size() - offset < 8) { throw hresult_invalid_argument(L"Truncated SID."); }
+            const uint32_t length = 8 + 4 * sids[offset + 1];
+            if (sids.size() - offset < length) { throw hresult_invalid_argument(L"Truncated SID."); }
+
+            const PSID sid = const_cast<uint8_t*>(sids.data() + offset);
+            if (!IsValidSid(sid) || GetLengthSid(sid) != length) { throw hresult_invalid_argument(L"Invalid SID."); }
+            Append(sid);
+            offset += length;
+        }
+    }
+
+    const bool SidArray::Contains(const PSID sid) const
+    {
+        if (!sid || !IsValidSid(sid)) { return false; }
+        probe = sid;
+        const bool result = keys.contains(Probe);
+        probe = nullptr;
+        return result;
+    }
+
+    PSID_AND_ATTRIBUTES SidArray::Data()
+    {
+        entries.resize(offsets.size());
+        for (size_t i = 0; i < offsets.size(); i++)
+        {
+            entries[i] = { bytes.data() + offsets[i], 0 };
+        }
+        return entries.data();
+    }
+
+    vector<hstring> SidArray::ToStrings() const
+    {
+        vector<hstring> list;
+        list.reserve(offsets.size());
+        for (uint32_t i = 0; i < Size(); i++)
+        {
+            LPWSTR stringSid = nullptr;
+            if (ConvertSidToStringSid(GetAt(i), &stringSid) && stringSid)
+            {
+                list.emplace_back(stringSid);
+                LocalFree(stringSid);
+            }
+        }
+        return list;
+    }
+
+    const size_t SidArray::KeyHash::operator()(const uint32_t index) const
+    {
+        return hash<string_view>()(owner->GetKey(index));
+    }
+
+    const bool SidArray::KeyEqual::operator()(const uint32_t left, const uint32_t right) const
+    {
+        return owner->GetKey(left) == owner->GetKey(right);
+    }
+
+    const string_view SidArray::GetKey(const uint32_t index) const
+    {
+        const PSID sid = index == Probe ? probe : GetAt(index);
+        return string_view(static_cast<const char*>(sid), GetLengthSid(sid));
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <winrt/LoopBack.Metadata.h>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Contiguous SID_AND_ATTRIBUTES list for NetworkIsolationSetAppContainerConfig. SIDs are
+    // copied straight into one byte buffer whatever they come from: SID strings are parsed in
+    // place, containers of this process hand over their SID without a copy, and packed binary
+    // SIDs are copied as they are. Duplicates are dropped on the way in. The attribute entries
+    // point into the buffer, so they are only built by Data once the list is complete.
+    struct SidArray
+    {
+        SidArray();
+        SidArray(const SidArray&) = delete;
+        SidArray& operator=(const SidArray&) = delete;
+
+        // Each returns whether the SID was valid; a valid duplicate is still dropped.
+        const bool Append(const PSID sid);
+        const bool Append(const std::wstring_view stringSid);
+        const bool Append(const LoopBack::Metadata::AppContainer& app)
+        {
+            bool isLocal = true;
+            return Append(app, isLocal);
+        }
+        // Takes the SID through IAppContainerNative while isLocal is set, and clears it at the
+        // first container that is not of this process. A range of proxies then costs one failed
+        // query rather than a remote query per container.
+        const bool Append(const LoopBack::Metadata::AppContainer& app, bool& isLocal);
+        // Appends SIDs packed back to back, and throws if the buffer is not made of valid SIDs.
+        void AppendPacked(const array_view<uint8_t const>& sids);
+
+        // Appends a single SID string or container, packed binary SIDs, or any range of SID
+        // strings or containers, and returns whether every SID was valid. The source is resolved
+        // at compile time, so a range of strings or containers of this process goes into the
+        // buffer without anything in between.
+        template <typename TSource>
+        const bool AppendAll(const TSource& source)
+        {
+            if constexpr (std::is_same_v<TSource, array_view<uint8_t const>>)
+            {
+                AppendPacked(source);
+                return true;
+            }
+            else if constexpr (std::is_convertible_v<const TSource&, std::wstring_view> || std::is_same_v<TSource, LoopBack::Metadata::AppContainer>)
+            {
+                return Append(source);
+            }
+            else
+            {
+                bool isValid = true;
+                bool isLocal = true;
+                for (const auto& item : source)
+                {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(item)>, LoopBack::Metadata::AppContainer>)
+                    {
+                        if (!Append(item, isLocal)) { isValid = false; }
+                    }
+                    else
+                    {
+                        if (!Append(item)) { isValid = false; }
+                    }
+                }
+                return isValid;
+            }
+        }
+
+        const bool Contains(const PSID sid) const;
+        const DWORD Size() const { return static_cast<DWORD>(offsets.size()); }
+        const PSID GetAt(const uint32_t index) const { return const_cast<uint8_t*>(bytes.data() + offsets[index]); }
+        PSID_AND_ATTRIBUTES Data();
+        std::vector<hstring> ToStrings() const;
+
+    private:
+        static constexpr uint32_t Probe = UINT32_MAX;
+
+        struct KeyHash
+        {
+            const SidArray* owner;
+            const size_t operator()(const uint32_t index) const;
+        };
+
+        struct KeyEqual
+        {
+            const SidArray* owner;
+            const bool operator()(const uint32_t left, const uint32_t right) const;
+        };
+
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> offsets;
+        std::vector<SID_AND_ATTRIBUTES> entries;
+        std::unordered_set<uint32_t, KeyHash, KeyEqual> keys;
+        mutable PSID probe = nullptr;
+
+        const std::string_view GetKey(const uint32_t index) const;
+    };
+}
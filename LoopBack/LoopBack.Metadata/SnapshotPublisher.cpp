@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "SnapshotPublisher.h"
+#include "ClientImpersonation.h"
+#include "SnapshotSection.h"
+#include <rpc.h>
+
+#pragma comment(lib,"rpcrt4.lib")
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    SnapshotPublisher& SnapshotPublisher::Current()
+    {
+        static SnapshotPublisher publisher;
+        return publisher;
+    }
+
+    void SnapshotPublisher::Publish(const hstring& scope, const uint64_t serial, const uint64_t etag, const vector<AppContainer>& apps)
+    {
+        const lock_guard<mutex> guard(lock);
+        Section& section = sections[scope];
+        //A build that finished after a later one must not replace it. The same snapshot is
+        //published again after commits changed its exemption flags.
+        if (serial < section.Serial) { return; }
+        section.Serial = serial;
+        //Every client refreshes on a new version, so content it already has is not written again.
+        if (section.ETag == etag) { return; }
+        section.ETag = etag;
+        section.Latest = apps;
+        //Nothing is written until a client has mapped the section.
+        if (section.View)
+        {
+            Write(section);
+        }
+    }
+
+    const SnapshotSectionHandles SnapshotPublisher::Share(const hstring& scope)
+    {
+        const DWORD processId = GetCallerProcessId();
+        const lock_guard<mutex> guard(lock);
+        Section& section = sections[scope];
+        if (!section.View)
+        {
+            section.Mapping.attach(CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(SectionSize), nullptr));
+            if (!section.Mapping) { throw_last_error(); }
+            section.View = MapViewOfFile(section.Mapping.get(), FILE_MAP_WRITE, 0, 0, 0);
+            if (!section.View) { throw_last_error(); }
+            SnapshotSection::Initialize(section.View, SectionSize);
+            Write(section);
+        }
+
+        Client client;
+        client.Process.attach(OpenProcess(PROCESS_DUP_HANDLE | SYNCHRONIZE, FALSE, processId));
+        if (!client.Process) { throw_last_error(); }
+        client.VersionChanged.attach(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+        if (!client.VersionChanged) { throw_last_error(); }
+
+        //The client only gets read access to the section and may only wait on the event.
+        HANDLE clientSection = nullptr;
+        HANDLE clientEvent = nullptr;
+        check_bool(DuplicateHandle(GetCurrentProcess(), section.Mapping.get(), client.Process.get(), &clientSection, FILE_MAP_READ, FALSE, 0));
+        if (!DuplicateHandle(GetCurrentProcess(), client.VersionChanged.get(), client.Process.get(), &clientEvent, SYNCHRONIZE, FALSE, 0))
+        {
+            const DWORD error = GetLastError();
+            DuplicateHandle(client.Process.get(), clientSection, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+            throw_hresult(HRESULT_FROM_WIN32(error));
+        }
+
+        section.Clients.push_back(move(client));
+        return { reinterpret_cast<uint64_t>(clientSection), reinterpret_cast<uint64_t>(clientEvent) };
+    }
+
+    void SnapshotPublisher::Write(Section& section)
+    {
+        Encode(section.Latest);
+        if (!SnapshotSection::Publish(section.View, buffer.size(), [&](uint8_t* target) { memcpy(target, buffer.data(), buffer.size()); }))
+        {
+            //Too large for the section, clients keep the previous version and use COM.
+            return;
+        }
+
+        //Clients that went away no longer need to be told.
+        erase_if(section.Clients, [](const Client& client)
+            {
+                return WaitForSingleObject(client.Process.get(), 0) == WAIT_OBJECT_0;
+            });
+        for (const Client& client : section.Clients)
+        {
+            SetEvent(client.VersionChanged.get());
+        }
+    }
+
+    const DWORD SnapshotPublisher::GetCallerProcessId()
+    {
+        //Handles are only duplicated into the process the RPC runtime says the call came from,
+        //so a client cannot have them sent to a process it does not control.
+        if (!ClientImpersonation::HasCallContext()) { return GetCurrentProcessId(); }
+
+        unsigned long processId = 0;
+        check_hresult(HRESULT_FROM_WIN32(I_RpcBindingInqLocalClientPID(nullptr, &processId)));
+        return processId;
+    }
+
+    void SnapshotPublisher::Encode(const vector<AppContainer>& apps)
+    {
+        using Section = SnapshotSection;
+        vector<Section::Record> records;
+        vector<Section::String> listItems;
+        wstring pool;
+        records.reserve(apps.size());
+
+        const auto append = [&](const hstring& value)
+            {
+                const Section::String result{ static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(value.size()) };
+                pool.append(value);
+                return result;
+            };
+        const auto appendList = [&](const IVector<hstring>& values)
+            {
+                Section::List result{ static_cast<uint32_t>(listItems.size()), 0 };
+                if (values)
+                {
+                    for (const hstring& value : values)
+                    {
+                        listItems.push_back(append(value));
+                    }
+                    result.Count = static_cast<uint32_t>(listItems.size()) - result.First;
+                }
+                return result;
+            };
+
+        for (const AppContainer& app : apps)
+        {
+            Section::Record record{};
+            record.IsEnableLoop = app.IsEnableLoop();
+            record.Strings[Section::DisplayName] = append(app.DisplayName());
+            record.Strings[Section::Description] = append(app.Description());
+            record.Strings[Section::AppContainerName] = append(app.AppContainerName());
+            record.Strings[Section::PackageFullName] = append(app.PackageFullName());
+            record.Strings[Section::WorkingDirectory] = append(app.WorkingDirectory());
+            record.Strings[Section::AppContainerSid] = append(app.AppContainerSid());
+            record.Strings[Section::UserSid] = append(app.UserSid());
+            record.Capabilities = appendList(app.Capabilities());
+            record.Binaries = appendList(app.Binaries());
+            records.push_back(record);
+        }
+
+        const Section::Table table{ static_cast<uint32_t>(records.size()), static_cast<uint32_t>(listItems.size()), static_cast<uint32_t>(pool.size()), 0 };
+        buffer.clear();
+        const auto write = [&](const void* data, const size_t size)
+            {
+                const uint8_t* bytes = static_cast<const uint8_t*>(data);
+                buffer.insert(buffer.end(), bytes, bytes + size);
+            };
+        write(&table, sizeof(table));
+        write(records.data(), records.size() * sizeof(Section::Record));
+        write(listItems.data(), listItems.size() * sizeof(Section::String));
+        write(pool.data(), pool.size() * sizeof(wchar_t));
+    }
+}
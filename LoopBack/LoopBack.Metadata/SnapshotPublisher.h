@@ -0,0 +1,54 @@
+#pragma once
+
+#include <winrt/LoopBack.Metadata.h>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Publishes the latest snapshot of every user scope into its own pagefile backed
+    // SnapshotSection, so a scoped build never replaces what the clients of another scope
+    // read. A section is created when the first client of its scope asks for it; every
+    // client gets a read-only duplicate of the section handle and its own version-changed event.
+    struct SnapshotPublisher
+    {
+        static constexpr size_t SectionSize = 16 * 1024 * 1024;
+
+        static SnapshotPublisher& Current();
+
+        // Publishes the apps of the snapshot with the given serial and ETag, unless the section
+        // of scope already holds a later snapshot or the same content.
+        void Publish(const hstring& scope, const uint64_t serial, const uint64_t etag, const std::vector<AppContainer>& apps);
+        // Shares the section of scope with the process of the COM client making the call.
+        const SnapshotSectionHandles Share(const hstring& scope);
+
+    private:
+        struct Client
+        {
+            handle Process;
+            handle VersionChanged;
+        };
+
+        struct Section
+        {
+            handle Mapping;
+            void* View = nullptr;
+            uint64_t Serial = 0;
+            std::optional<uint64_t> ETag;
+            std::vector<AppContainer> Latest;
+            std::vector<Client> Clients;
+        };
+
+        std::mutex lock;
+        std::unordered_map<hstring, Section> sections;
+        std::vector<uint8_t> buffer;
+
+        SnapshotPublisher() = default;
+
+        void Write(Section& section);
+        void Encode(const std::vector<AppContainer>& apps);
+        static const DWORD GetCallerProcessId();
+    };
+}
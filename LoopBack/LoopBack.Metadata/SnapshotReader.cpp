@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "SnapshotReader.h"
+#include "SnapshotReader.g.cpp"
+#include "SnapshotSection.h"
+#include "SnapshotView.h"
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    SnapshotReader::SnapshotReader(const SnapshotSectionHandles& handles)
+    {
+        section.attach(reinterpret_cast<HANDLE>(handles.Section));
+        versionChanged.attach(reinterpret_cast<HANDLE>(handles.VersionChanged));
+
+        const void* mapped = MapViewOfFile(section.get(), FILE_MAP_READ, 0, 0, 0);
+        if (!mapped) { throw_last_error(); }
+        //Views handed out by ReadWithFields share the mapping, so it outlives Close while they are in use.
+        view.reset(mapped, [](const void* base) { UnmapViewOfFile(base); });
+
+        if (versionChanged)
+        {
+            check_bool(RegisterWaitForSingleObject(&wait, versionChanged.get(), OnVersionChanged, this, INFINITE, WT_EXECUTEDEFAULT));
+        }
+    }
+
+    SnapshotReader::~SnapshotReader()
+    {
+        Close();
+    }
+
+    const uint64_t SnapshotReader::Version() const
+    {
+        if (!view) { return 0; }
+        return SnapshotSection::GetHeader(view.get())->Sequence.load(memory_order_acquire) & ~uint64_t(1);
+    }
+
+    IVectorView<AppContainer> SnapshotReader::ReadWithFields(const AppContainerFields& fields) const
+    {
+        if (!view) { throw hresult_illegal_method_call(); }
+        return make<SnapshotView>(view, fields);
+    }
+
+    event_token SnapshotReader::VersionChanged(const TypedEventHandler<LoopBack::Metadata::SnapshotReader, uint64_t>& handler)
+    {
+        return m_versionChangedEvent.add(handler);
+    }
+
+    void SnapshotReader::VersionChanged(const event_token& token)
+    {
+        m_versionChangedEvent.remove(token);
+    }
+
+    void SnapshotReader::Close()
+    {
+        if (wait)
+        {
+            //Wait for a running callback, it still uses this instance.
+            UnregisterWaitEx(wait, INVALID_HANDLE_VALUE);
+            wait = nullptr;
+        }
+        view.reset();
+        versionChanged.close();
+        section.close();
+    }
+
+    void CALLBACK SnapshotReader::OnVersionChanged(PVOID context, BOOLEAN)
+    {
+        SnapshotReader* reader = static_cast<SnapshotReader*>(context);
+        reader->m_versionChangedEvent(*reader, reader->Version());
+    }
+}
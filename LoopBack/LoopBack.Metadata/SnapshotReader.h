@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SnapshotReader.g.h"
+#include <memory>
+
+using namespace winrt;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Maps the snapshot section shared by the server and reads it in place through lazy
+    // SnapshotViews. The handles were duplicated into this process by
+    // LoopUtil.ShareSnapshotSection and are owned here.
+    struct SnapshotReader : SnapshotReaderT<SnapshotReader>
+    {
+        SnapshotReader(const SnapshotSectionHandles& handles);
+        ~SnapshotReader();
+
+        const uint64_t Version() const;
+        IVectorView<AppContainer> Read() const { return ReadWithFields(AppContainerFields::All); }
+        IVectorView<AppContainer> ReadWithFields(const AppContainerFields& fields) const;
+
+        event_token VersionChanged(const TypedEventHandler<LoopBack::Metadata::SnapshotReader, uint64_t>& handler);
+        void VersionChanged(const event_token& token);
+
+        void Close();
+
+    private:
+        handle section;
+        handle versionChanged;
+        std::shared_ptr<const void> view;
+        HANDLE wait = nullptr;
+        event<TypedEventHandler<LoopBack::Metadata::SnapshotReader, uint64_t>> m_versionChangedEvent;
+
+        static void CALLBACK OnVersionChanged(PVOID context, BOOLEAN isTimeout);
+    };
+}
+
+namespace winrt::LoopBack::Metadata::factory_implementation
+{
+    struct SnapshotReader : SnapshotReaderT<SnapshotReader, implementation::SnapshotReader>
+    {
+    };
+}
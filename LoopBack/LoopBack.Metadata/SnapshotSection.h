@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Layout and seqlock protocol of the shared memory section the server publishes its
+    // snapshot into. The section is a header followed by two equally sized buffers. A
+    // publisher fills the inactive buffer while Sequence is odd and makes it active by
+    // bumping Sequence back to even, so readers keep using the active buffer during a
+    // publish. A reader remembers Sequence, reads the active buffer in place and only trusts
+    // what it read if Sequence has not moved meanwhile, which would mean the buffer may have
+    // been reused. Only the standard library is used, so the protocol works over any mapping.
+    struct SnapshotSection
+    {
+        static constexpr uint32_t Magic = 0x31534C4C; // LLS1
+        static constexpr uint32_t ReadAttempts = 64;
+
+        struct Header
+        {
+            uint32_t Magic;
+            uint32_t Reserved;
+            std::atomic<uint64_t> Sequence;
+            std::atomic<uint32_t> ActiveBuffer;
+            uint32_t Reserved2;
+            std::atomic<uint64_t> Length[2];
+            uint64_t Capacity;
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared atomics must be lock free.");
+
+        static constexpr size_t HeaderSize = (sizeof(Header) + 63) & ~size_t(63);
+
+        static Header* GetHeader(void* base) { return static_cast<Header*>(base); }
+        static const Header* GetHeader(const void* base) { return static_cast<const Header*>(base); }
+
+        static uint8_t* GetBuffer(void* base, const uint32_t index)
+        {
+            return static_cast<uint8_t*>(base) + HeaderSize + index * GetHeader(base)->Capacity;
+        }
+
+        static const uint8_t* GetBuffer(const void* base, const uint32_t index)
+        {
+            return static_cast<const uint8_t*>(base) + HeaderSize + index * GetHeader(base)->Capacity;
+        }
+
+        static void Initialize(void* base, const size_t size)
+        {
+            Header* header = new (base) Header{};
+            header->Magic = Magic;
+            header->Capacity = ((size - HeaderSize) / 2) & ~uint64_t(7);
+        }
+
+        // Copies length bytes produced by write into the inactive buffer and publishes them.
+        // Returns false when the data does not fit; the previous version then stays current.
+        // Only one publisher may call this at a time.
+        template <typename TWrite>
+        static const bool Publish(void* base, const size_t length, TWrite&& write)
+        {
+            Header* header = GetHeader(base);
+            if (length > header->Capacity) { return false; }
+
+            const uint32_t next = header->ActiveBuffer.load(std::memory_order_relaxed) ^ 1;
+            const uint64_t sequence = header->Sequence.load(std::memory_order_relaxed);
+            header->Sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            write(GetBuffer(base, next));
+            header->Length[next].store(length, std::memory_order_relaxed);
+            header->ActiveBuffer.store(next, std::memory_order_release);
+
+            header->Sequence.store(sequence + 2, std::memory_order_release);
+            return true;
+        }
+
+        // Calls read with the active buffer until it completes without a publish racing it.
+        // read must tolerate torn data, since it is only validated afterwards, and returns
+        // false to give up. Returns the version that was read, or 0 when nothing was.
+        template <typename TRead>
+        static const uint64_t Read(const void* base, TRead&& read)
+        {
+            const Header* header = GetHeader(base);
+            if (header->Magic != Magic) { return 0; }
+
+            for (uint32_t attempt = 0; attempt < ReadAttempts; attempt++)
+            {
+                const uint64_t sequence = header->Sequence.load(std::memory_order_acquire);
+                if (sequence < 2) { return 0; }
+
+                const uint32_t active = header->ActiveBuffer.load(std::memory_order_acquire) & 1;
+                const uint64_t length = header->Length[active].load(std::memory_order_relaxed);
+                if (length > header->Capacity) { continue; }
+                const bool isRead = read(GetBuffer(base, active), static_cast<size_t>(length));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header->Sequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    return isRead ? sequence & ~uint64_t(1) : 0;
+                }
+            }
+            return 0;
+        }
+
+        // Finds the active buffer for a reader that keeps using it in place instead of copying
+        // it out. Returns its version, or 0 when nothing was published or every attempt raced a
+        // publish. Whatever is read from the buffer is only valid while IsCurrent holds afterwards.
+        static const uint64_t BeginRead(const void* base, const uint8_t*& buffer, size_t& length)
+        {
+            const Header* header = GetHeader(base);
+            if (header->Magic != Magic) { return 0; }
+
+            for (uint32_t attempt = 0; attempt < ReadAttempts; attempt++)
+            {
+                const uint64_t sequence = header->Sequence.load(std::memory_order_acquire);
+                if (sequence < 2) { return 0; }
+                if (sequence & 1) { continue; }
+
+                const uint32_t active = header->ActiveBuffer.load(std::memory_order_acquire) & 1;
+                const uint64_t size = header->Length[active].load(std::memory_order_relaxed);
+                if (size <= header->Capacity && IsCurrent(base, sequence))
+                {
+                    buffer = GetBuffer(base, active);
+                    length = static_cast<size_t>(size);
+                    return sequence;
+                }
+            }
+            return 0;
+        }
+
+        // Gets whether no publish has started since BeginRead returned version.
+        static const bool IsCurrent(const void* base, const uint64_t version)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return GetHeader(base)->Sequence.load(std::memory_order_relaxed) == version;
+        }
+
+        // Encoding of a snapshot inside a buffer: a Table, Count Records, ListCount list
+        // entries and then the pool of UTF-16 characters the strings point into.
+        struct String
+        {
+            uint32_t Offset;
+            uint32_t Length;
+        };
+
+        struct List
+        {
+            uint32_t First;
+            uint32_t Count;
+        };
+
+        enum StringField : uint32_t
+        {
+            DisplayName,
+            Description,
+            AppContainerName,
+            PackageFullName,
+            WorkingDirectory,
+            AppContainerSid,
+            UserSid,
+            StringFieldCount
+        };
+
+        struct Record
+        {
+            uint32_t IsEnableLoop;
+            String Strings[StringFieldCount];
+            List Capabilities;
+            List Binaries;
+        };
+
+        struct Table
+        {
+            uint32_t Count;
+            uint32_t ListCount;
+            uint32_t PoolLength;
+            uint32_t Reserved;
+        };
+    };
+}
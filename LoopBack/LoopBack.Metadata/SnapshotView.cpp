@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "SnapshotView.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    namespace
+    {
+        struct SnapshotIterator : implements<SnapshotIterator, IIterator<AppContainer>>
+        {
+            SnapshotIterator(const com_ptr<SnapshotView>& view) : view(view) {}
+
+            AppContainer Current() const
+            {
+                if (!HasCurrent()) { throw hresult_out_of_bounds(); }
+                return view->GetAt(index);
+            }
+
+            bool HasCurrent() const { return index < view->Size(); }
+
+            bool MoveNext()
+            {
+                if (HasCurrent()) { index++; }
+                return HasCurrent();
+            }
+
+            uint32_t GetMany(array_view<AppContainer> items)
+            {
+                const uint32_t count = view->GetMany(index, items);
+                index += count;
+                return count;
+            }
+
+        private:
+            com_ptr<SnapshotView> view;
+            uint32_t index = 0;
+        };
+
+        [[noreturn]] void ThrowInvalidData()
+        {
+            throw hresult_error(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), L"The snapshot section is corrupt.");
+        }
+    }
+
+    SnapshotView::SnapshotView(const shared_ptr<const void>& mapping, const AppContainerFields fields) : mapping(mapping), fields(fields & AppContainerFields::All)
+    {
+        size_t length = 0;
+        version = Section::BeginRead(mapping.get(), buffer, length);
+        if (!version) { throw hresult_error(E_PENDING, L"No consistent snapshot could be read."); }
+
+        //The buffer may be reused by the next publish at any time, so the table is bounds
+        //checked first and only trusted once the version is still current afterwards.
+        bool isValid = length >= sizeof(Section::Table);
+        if (isValid)
+        {
+            memcpy(&table, buffer, sizeof(table));
+            recordsOffset = sizeof(Section::Table);
+            listOffset = recordsOffset + static_cast<size_t>(table.Count) * sizeof(Section::Record);
+            const size_t poolOffset = listOffset + static_cast<size_t>(table.ListCount) * sizeof(Section::String);
+            isValid = poolOffset + static_cast<size_t>(table.PoolLength) * sizeof(wchar_t) <= length;
+            pool = reinterpret_cast<const wchar_t*>(buffer + poolOffset);
+        }
+        CheckCurrent();
+        if (!isValid) { ThrowInvalidData(); }
+    }
+
+    AppContainer SnapshotView::GetAt(const uint32_t index) const
+    {
+        if (index >= table.Count) { throw hresult_out_of_bounds(); }
+
+        //The field each encoded string belongs to, in StringField order.
+        static constexpr AppContainerFields stringFields[Section::StringFieldCount] =
+        {
+            AppContainerFields::DisplayName,
+            AppContainerFields::Description,
+            AppContainerFields::AppContainerName,
+            AppContainerFields::PackageFullName,
+            AppContainerFields::WorkingDirectory,
+            AppContainerFields::AppContainerSid,
+            AppContainerFields::UserSid
+        };
+        const auto has = [&](const AppContainerFields field) { return (fields & field) == field; };
+
+        const Section::Record record = GetRecord(index);
+        bool isValid = true;
+        hstring strings[Section::StringFieldCount];
+        for (uint32_t field = 0; field < Section::StringFieldCount && isValid; field++)
+        {
+            wstring_view value;
+            if (has(stringFields[field]))
+            {
+                isValid = GetString(record.Strings[field], value);
+                strings[field] = hstring(value);
+            }
+        }
+        IVector<hstring> capabilities = nullptr;
+        IVector<hstring> binaries = nullptr;
+        if (isValid && has(AppContainerFields::Capabilities)) { isValid = GetList(record.Capabilities, capabilities); }
+        if (isValid && has(AppContainerFields::Binaries)) { isValid = GetList(record.Binaries, binaries); }
+
+        //Everything was copied out of the buffer, so a check now covers all of it.
+        CheckCurrent();
+        if (!isValid) { ThrowInvalidData(); }
+
+        AppContainer app = AppContainer::AppContainer();
+        app.Fields(fields);
+        app.IsEnableLoop(has(AppContainerFields::IsEnableLoop) && record.IsEnableLoop != 0);
+        app.DisplayName(strings[Section::DisplayName]);
+        app.Description(strings[Section::Description]);
+        app.AppContainerName(strings[Section::AppContainerName]);
+        app.PackageFullName(strings[Section::PackageFullName]);
+        app.WorkingDirectory(strings[Section::WorkingDirectory]);
+        app.AppContainerSid(strings[Section::AppContainerSid]);
+        app.UserSid(strings[Section::UserSid]);
+        app.Capabilities(capabilities);
+        app.Binaries(binaries);
+        return app;
+    }
+
+    bool SnapshotView::IndexOf(const AppContainer& value, uint32_t& index) const
+    {
+        //Records are decoded on every access, so a container is found by its SIDs rather than by instance.
+        const hstring sid = value ? value.AppContainerSid() : hstring();
+        const hstring userSid = value ? value.UserSid() : hstring();
+        bool isFound = false;
+        for (uint32_t i = 0; i < table.Count && !isFound; i++)
+        {
+            const Section::Record record = GetRecord(i);
+            wstring_view recordSid;
+            wstring_view recordUserSid;
+            if (GetString(record.Strings[Section::AppContainerSid], recordSid) && recordSid == wstring_view(sid)
+                && GetString(record.Strings[Section::UserSid], recordUserSid) && recordUserSid == wstring_view(userSid))
+            {
+                index = i;
+                isFound = true;
+            }
+        }
+        CheckCurrent();
+        return isFound;
+    }
+
+    uint32_t SnapshotView::GetMany(const uint32_t startIndex, array_view<AppContainer> items) const
+    {
+        if (startIndex >= table.Count) { return 0; }
+        const uint32_t count = min(items.size(), table.Count - startIndex);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            items[i] = GetAt(startIndex + i);
+        }
+        return count;
+    }
+
+    IIterator<AppContainer> SnapshotView::First()
+    {
+        return make<SnapshotIterator>(get_strong());
+    }
+
+    const SnapshotSection::Record SnapshotView::GetRecord(const uint32_t index) const
+    {
+        Section::Record record;
+        memcpy(&record, buffer + recordsOffset + static_cast<size_t>(index) * sizeof(record), sizeof(record));
+        return record;
+    }
+
+    const bool SnapshotView::GetString(const Section::String& value, wstring_view& result) const
+    {
+        if (static_cast<uint64_t>(value.Offset) + value.Length > table.PoolLength) { return false; }
+        result = wstring_view(pool + value.Offset, value.Length);
+        return true;
+    }
+
+    const bool SnapshotView::GetList(const Section::List& value, IVector<hstring>& result) const
+    {
+        if (static_cast<uint64_t>(value.First) + value.Count > table.ListCount) { return false; }
+        vector<hstring> items(value.Count);
+        for (uint32_t i = 0; i < value.Count; i++)
+        {
+            Section::String item;
+            memcpy(&item, buffer + listOffset + (static_cast<size_t>(value.First) + i) * sizeof(Section::String), sizeof(item));
+            wstring_view text;
+            if (!GetString(item, text)) { return false; }
+            items[i] = hstring(text);
+        }
+        result = single_threaded_vector<hstring>(move(items));
+        return true;
+    }
+
+    void SnapshotView::CheckCurrent() const
+    {
+        if (!Section::IsCurrent(mapping.get(), version))
+        {
+            throw hresult_changed_state(L"The snapshot was replaced, read it again.");
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "SnapshotSection.h"
+#include <winrt/LoopBack.Metadata.h>
+#include <memory>
+
+using namespace winrt;
+using namespace LoopBack::Metadata;
+using namespace Windows::Foundation::Collections;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // A lazy view over one version of the mapped snapshot section. Nothing is copied up
+    // front: a container is decoded from the shared buffer when it is asked for, with only
+    // the requested fields. Every access checks the version afterwards and fails with
+    // E_CHANGED_STATE once a publish has started, so a torn record never reaches the caller.
+    struct SnapshotView : implements<SnapshotView, IVectorView<AppContainer>, IIterable<AppContainer>>
+    {
+        // Keeps mapping alive for as long as the view is, even after the reader is closed.
+        SnapshotView(const std::shared_ptr<const void>& mapping, const AppContainerFields fields);
+
+        AppContainer GetAt(const uint32_t index) const;
+        uint32_t Size() const { return table.Count; }
+        bool IndexOf(const AppContainer& value, uint32_t& index) const;
+        uint32_t GetMany(const uint32_t startIndex, array_view<AppContainer> items) const;
+        IIterator<AppContainer> First();
+
+        const uint64_t Version() const { return version; }
+
+    private:
+        using Section = SnapshotSection;
+
+        std::shared_ptr<const void> mapping;
+        AppContainerFields fields;
+        uint64_t version = 0;
+        const uint8_t* buffer = nullptr;
+        Section::Table table{};
+        size_t recordsOffset = 0;
+        size_t listOffset = 0;
+        const wchar_t* pool = nullptr;
+
+        const Section::Record GetRecord(const uint32_t index) const;
+        const bool GetString(const Section::String& value, std::wstring_view& result) const;
+        const bool GetList(const Section::List& value, IVector<hstring>& result) const;
+        void CheckCurrent() const;
+    };
+}
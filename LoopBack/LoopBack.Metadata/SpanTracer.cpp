@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "SpanTracer.h"
+#include "ClientImpersonation.h"
+#include <format>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    const wstring SpanTracer::GetEnvironmentPath()
+    {
+        wstring path(MAX_PATH, L'\0');
+        DWORD size = GetEnvironmentVariable(L"LOOPBACK_TRACE", path.data(), static_cast<DWORD>(path.size()));
+        if (size >= path.size())
+        {
+            path.resize(size);
+            size = GetEnvironmentVariable(L"LOOPBACK_TRACE", path.data(), static_cast<DWORD>(path.size()));
+        }
+        path.resize(size < path.size() ? size : 0);
+        return path;
+    }
+
+    const int64_t SpanTracer::Now() noexcept
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    SpanTracer::Buffer* SpanTracer::GetBuffer() noexcept
+    {
+        thread_local Buffer* buffer = nullptr;
+        if (!buffer)
+        {
+            buffer = new (nothrow) Buffer();
+            if (!buffer) { return nullptr; }
+            buffer->Next = buffers.load(memory_order_relaxed);
+            while (!buffers.compare_exchange_weak(buffer->Next, buffer, memory_order_release, memory_order_relaxed))
+            {
+            }
+        }
+        return buffer;
+    }
+
+    void SpanTracer::Record(const char* name, const int64_t begin, const int64_t end, const uint32_t threadId) noexcept
+    {
+        Buffer* buffer = GetBuffer();
+        if (!buffer) { return; }
+
+        //Only this thread writes the count, so a relaxed read is enough.
+        const uint64_t written = buffer->Written.load(memory_order_relaxed);
+        buffer->Events[written % BufferCapacity] = { name, begin, end, threadId };
+        buffer->Written.store(written + 1, memory_order_release);
+    }
+
+    void SpanTracer::Export(const wstring_view path)
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        const double scale = 1000000.0 / frequency.QuadPart;
+        const DWORD processId = GetCurrentProcessId();
+
+        string json = "{\"traceEvents\":[";
+        bool isFirst = true;
+        uint64_t dropped = 0;
+        vector<Event> events;
+        for (const Buffer* buffer = buffers.load(memory_order_acquire); buffer; buffer = buffer->Next)
+        {
+            //The owner keeps recording, so the ring is copied first and the spans it may have
+            //overwritten meanwhile are left out.
+            const uint64_t written = buffer->Written.load(memory_order_acquire);
+            const uint64_t first = written > BufferCapacity ? written - BufferCapacity : 0;
+            events.clear();
+            for (uint64_t i = first; i < written; i++)
+            {
+                events.push_back(buffer->Events[i % BufferCapacity]);
+            }
+            atomic_thread_fence(memory_order_acquire);
+            const uint64_t overwritten = buffer->Written.load(memory_order_relaxed);
+            const uint64_t valid = min(written, max(first, overwritten > BufferCapacity ? overwritten - BufferCapacity : 0));
+            dropped += valid;
+
+            for (uint64_t i = valid; i < written; i++)
+            {
+                const Event& item = events[static_cast<size_t>(i - first)];
+                json.append(isFirst ? "\n" : ",\n");
+                json.append(format(
+                    "{{\"name\":\"{}\",\"cat\":\"LoopBack\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+                    item.Name,
+                    item.Begin * scale,
+                    (item.End - item.Begin) * scale,
+                    processId,
+                    item.ThreadId));
+                isFirst = false;
+            }
+        }
+        json.append(format("\n],\"displayTimeUnit\":\"ms\",\"otherData\":{{\"droppedEvents\":{}}}}}\n", dropped));
+
+        //ExportTrace passes a client's path, which must not be written with the server's token.
+        const ClientImpersonation impersonation;
+        file_handle file(CreateFile(
+            wstring(path).c_str(),
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (!file) { throw_last_error(); }
+
+        DWORD written = 0;
+        check_bool(WriteFile(file.get(), json.data(), static_cast<DWORD>(json.size()), &written, nullptr));
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Records timed spans into per-thread buffers and writes them out as Chrome
+    // trace-event JSON. A buffer is only written by the thread that owns it and is
+    // published with a release store, so recording takes no lock. While tracing is
+    // off a span costs a single relaxed load. Every buffer is a ring that keeps the
+    // latest BufferCapacity spans of its thread; older spans are overwritten and
+    // their count is written with the trace.
+    struct SpanTracer
+    {
+        static constexpr uint32_t BufferCapacity = 4096;
+
+        static const bool IsEnabled() noexcept { return enabled.load(std::memory_order_relaxed); }
+        static void IsEnabled(const bool value) noexcept { enabled.store(value, std::memory_order_relaxed); }
+
+        // Path given by the LOOPBACK_TRACE environment variable, or empty when unset.
+        static const std::wstring GetEnvironmentPath();
+
+        static const int64_t Now() noexcept;
+        static void Record(const char* name, const int64_t begin, const int64_t end, const uint32_t threadId) noexcept;
+        static void Export(const std::wstring_view path);
+
+    private:
+        struct Event
+        {
+            const char* Name;
+            int64_t Begin;
+            int64_t End;
+            uint32_t ThreadId;
+        };
+
+        // Buffers are linked into a list on first use and live until the process exits.
+        // Written counts every span ever recorded; span i is kept at i % BufferCapacity.
+        struct Buffer
+        {
+            std::atomic<uint64_t> Written = 0;
+            Buffer* Next = nullptr;
+            Event Events[BufferCapacity];
+        };
+
+        inline static std::atomic<bool> enabled = false;
+        inline static std::atomic<Buffer*> buffers = nullptr;
+
+        static Buffer* GetBuffer() noexcept;
+    };
+
+    // Times the enclosing scope. The name must be a string literal.
+    struct TraceSpan
+    {
+        explicit TraceSpan(const char* name) noexcept
+        {
+            if (SpanTracer::IsEnabled())
+            {
+                this->name = name;
+                threadId = GetCurrentThreadId();
+                begin = SpanTracer::Now();
+            }
+        }
+
+        ~TraceSpan()
+        {
+            if (name)
+            {
+                SpanTracer::Record(name, begin, SpanTracer::Now(), threadId);
+            }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        const char* name = nullptr;
+        int64_t begin = 0;
+        uint32_t threadId = 0;
+    };
+}
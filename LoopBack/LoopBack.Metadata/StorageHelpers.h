@@ -0,0 +1,26 @@
+#pragma once
+
+#include <shlobj_core.h>
+#include <string>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Gets the path of a state file kept by the server under %LOCALAPPDATA%\LoopBack,
+    // creating the directory on first use.
+    inline std::wstring GetStateFilePath(const std::wstring_view name)
+    {
+        PWSTR localAppData = nullptr;
+        check_hresult(SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_CREATE, nullptr, &localAppData));
+        std::wstring path(localAppData);
+        CoTaskMemFree(localAppData);
+
+        path.append(L"\\LoopBack");
+        if (!CreateDirectory(path.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            throw_last_error();
+        }
+
+        path.append(1, L'\\').append(name);
+        return path;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Upper-cases a string the same way the file system and package manager compare names,
+    // so the result can be used as a case-insensitive hash key.
+    inline std::wstring FoldCase(const std::wstring_view value)
+    {
+        std::wstring result(value);
+        if (!result.empty())
+        {
+            CharUpperBuffW(result.data(), static_cast<DWORD>(result.size()));
+        }
+        return result;
+    }
+
+    // Gets a case-insensitive sort key for the user locale. Keys compare with plain byte
+    // order, so a column can be sorted once without calling back into the collation per compare.
+    inline std::string GetSortKey(const std::wstring_view value)
+    {
+        constexpr DWORD flags = LCMAP_SORTKEY | LINGUISTIC_IGNORECASE;
+        if (value.empty()) { return {}; }
+        const int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, value.data(), static_cast<int>(value.size()), nullptr, 0, nullptr, nullptr, 0);
+        if (size <= 0)
+        {
+            const std::wstring folded = FoldCase(value);
+            return std::string(reinterpret_cast<const char*>(folded.data()), folded.size() * sizeof(wchar_t));
+        }
+        std::string result(static_cast<size_t>(size), '\0');
+        LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, value.data(), static_cast<int>(value.size()), reinterpret_cast<LPWSTR>(result.data()), size, nullptr, nullptr, 0);
+        //The key ends with a terminating zero byte that is not part of the order.
+        if (!result.empty() && result.back() == '\0') { result.pop_back(); }
+        return result;
+    }
+}
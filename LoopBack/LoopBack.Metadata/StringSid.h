@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Size of the largest SID, with the 15 sub-authorities SECURITY_MAX_SID_SIZE allows for.
+    constexpr uint32_t MaxSidSize = 8 + 4 * 15;
+
+    // Parses S-R-I-S-S... into buffer in the binary SID layout and returns the SID length,
+    // or 0 for anything else. The revision must be 1, the authority fits in 48 bits and each
+    // sub-authority in 32 bits, and every number may be written in decimal or with 0x in hex.
+    // Anything that is not in this form, such as an SDDL alias, is left to ConvertStringSidToSid.
+    inline const uint32_t ParseStringSid(const std::wstring_view stringSid, uint8_t(&buffer)[MaxSidSize])
+    {
+        size_t position = 0;
+        const auto readNumber = [&](uint64_t& value, const uint64_t limit)
+            {
+                if (position >= stringSid.size() || stringSid[position] != L'-') { return false; }
+                position++;
+                uint32_t base = 10;
+                if (stringSid.size() - position > 2 && stringSid[position] == L'0' && (stringSid[position + 1] == L'x' || stringSid[position + 1] == L'X'))
+                {
+                    base = 16;
+                    position += 2;
+                }
+                const size_t first = position;
+                value = 0;
+                for (; position < stringSid.size() && stringSid[position] != L'-'; position++)
+                {
+                    const wchar_t c = stringSid[position];
+                    uint32_t digit;
+                    if (c >= L'0' && c <= L'9') { digit = c - L'0'; }
+                    else if (base == 16 && c >= L'a' && c <= L'f') { digit = c - L'a' + 10; }
+                    else if (base == 16 && c >= L'A' && c <= L'F') { digit = c - L'A' + 10; }
+                    else { return false; }
+                    value = value * base + digit;
+                    if (value > limit) { return false; }
+                }
+                return position > first;
+            };
+
+        if (stringSid.empty() || (stringSid[0] != L'S' && stringSid[0] != L's')) { return 0; }
+        position = 1;
+        uint64_t revision, authority;
+        if (!readNumber(revision, 1) || revision != 1) { return 0; }
+        if (!readNumber(authority, 0xFFFFFFFFFFFFull)) { return 0; }
+
+        //Revision, sub-authority count, the authority as 6 big endian bytes, then the
+        //sub-authorities as native 32 bit values.
+        uint8_t count = 0;
+        buffer[0] = 1;
+        for (int i = 0; i < 6; i++)
+        {
+            buffer[2 + i] = static_cast<uint8_t>(authority >> (8 * (5 - i)));
+        }
+        while (position < stringSid.size())
+        {
+            uint64_t subAuthority;
+            if (count == 15 || !readNumber(subAuthority, 0xFFFFFFFFull)) { return 0; }
+            const uint32_t value = static_cast<uint32_t>(subAuthority);
+            std::memcpy(buffer + 8 + 4 * count++, &value, sizeof(value));
+        }
+        buffer[1] = count;
+        return 8 + 4 * count;
+    }
+}
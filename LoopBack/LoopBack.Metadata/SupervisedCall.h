@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Runs a backend call on a dedicated thread that callers wait on with a deadline.
+    // A caller that runs out of time simply stops waiting; the call keeps running on its
+    // own thread and owns everything it touches, so abandoning it blocks nobody, and a
+    // later caller can attach to it instead of starting another one. The thread is a plain
+    // one; work that needs COM joins the apartment itself.
+    template <typename TResult>
+    struct SupervisedCall
+    {
+        static std::shared_ptr<SupervisedCall> Start(std::function<TResult()> work)
+        {
+            const std::shared_ptr<SupervisedCall> call = std::make_shared<SupervisedCall>();
+            std::thread([call, work = std::move(work)]()
+                {
+                    std::optional<TResult> result;
+                    std::exception_ptr error;
+                    try
+                    {
+                        result.emplace(work());
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                    {
+                        const std::lock_guard<std::mutex> guard(call->lock);
+                        call->result = std::move(result);
+                        call->error = error;
+                        call->isCompleted = true;
+                    }
+                    call->completed.notify_all();
+                }).detach();
+            return call;
+        }
+
+        // Waits until the call completes or the deadline passes, and returns whether it completed.
+        const bool Wait(const std::chrono::milliseconds deadline)
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            return completed.wait_for(guard, deadline, [this]() { return isCompleted; });
+        }
+
+        const bool IsCompleted()
+        {
+            const std::lock_guard<std::mutex> guard(lock);
+            return isCompleted;
+        }
+
+        // Gets the result of a completed call, rethrowing what the call threw.
+        TResult Get()
+        {
+            const std::lock_guard<std::mutex> guard(lock);
+            if (error) { std::rethrow_exception(error); }
+            return *result;
+        }
+
+    private:
+        std::mutex lock;
+        std::condition_variable completed;
+        std::optional<TResult> result;
+        std::exception_ptr error;
+        bool isCompleted = false;
+    };
+}
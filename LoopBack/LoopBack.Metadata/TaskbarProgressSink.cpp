@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "TaskbarProgressSink.h"
+#include "TaskbarProgressSink.g.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    TaskbarProgressSink::TaskbarProgressSink(const LoopBack::Metadata::TaskbarList& taskbarList, const uint64_t hwnd) :
+        m_taskbarList(taskbarList.as<ITaskbarList3>()), hwnd(reinterpret_cast<HWND>(hwnd)), throttle(50)
+    {
+        timer = CreateThreadpoolTimer(OnTimer, this, nullptr);
+        if (!timer) { throw_last_error(); }
+    }
+
+    TaskbarProgressSink::~TaskbarProgressSink()
+    {
+        CloseTimer();
+    }
+
+    TimeSpan TaskbarProgressSink::MinInterval()
+    {
+        const lock_guard<mutex> guard(lock);
+        return duration_cast<TimeSpan>(milliseconds(throttle.MinInterval()));
+    }
+
+    void TaskbarProgressSink::MinInterval(const TimeSpan& value)
+    {
+        const lock_guard<mutex> guard(lock);
+        throttle.MinInterval(static_cast<uint64_t>(max<int64_t>(duration_cast<milliseconds>(value).count(), 0)));
+    }
+
+    void TaskbarProgressSink::SetProgressState(const TaskbarProgressState& value)
+    {
+        const lock_guard<mutex> guard(lock);
+        if (!m_taskbarList || (hasState && state == value)) { return; }
+        //A paused or failed bar keeps its fill, so it should show the latest value.
+        FlushPending();
+        check_hresult(m_taskbarList->SetProgressState(hwnd, static_cast<TBPFLAG>(value)));
+        state = value;
+        hasState = true;
+        if (value == TaskbarProgressState::NoProgress || value == TaskbarProgressState::Indeterminate)
+        {
+            //The bar drops its value here, so the next one has to be sent again.
+            throttle.Reset();
+        }
+    }
+
+    void TaskbarProgressSink::SetProgressValue(const uint64_t completed, const uint64_t total)
+    {
+        const lock_guard<mutex> guard(lock);
+        if (!m_taskbarList) { return; }
+        const uint64_t now = Now();
+        if (throttle.Offer(completed, total, now))
+        {
+            check_hresult(m_taskbarList->SetProgressValue(hwnd, completed, total));
+        }
+        else
+        {
+            ScheduleFlush(now);
+        }
+    }
+
+    void TaskbarProgressSink::Flush()
+    {
+        const lock_guard<mutex> guard(lock);
+        if (!m_taskbarList) { return; }
+        FlushPending();
+    }
+
+    void TaskbarProgressSink::Close()
+    {
+        {
+            const lock_guard<mutex> guard(lock);
+            if (!m_taskbarList) { return; }
+            try
+            {
+                FlushPending();
+            }
+            catch (...)
+            {
+                //The window may already be gone.
+            }
+            m_taskbarList = nullptr;
+        }
+        //The timer callback takes the lock, so it is waited for only once the lock is released.
+        CloseTimer();
+    }
+
+    const uint64_t TaskbarProgressSink::Now()
+    {
+        return static_cast<uint64_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    void CALLBACK TaskbarProgressSink::OnTimer(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER)
+    {
+        TaskbarProgressSink* sink = static_cast<TaskbarProgressSink*>(context);
+        const lock_guard<mutex> guard(sink->lock);
+        sink->isTimerSet = false;
+        if (!sink->m_taskbarList) { return; }
+        const uint64_t now = Now();
+        uint64_t due;
+        if (!sink->throttle.GetPendingDue(due)) { return; }
+        if (now < due)
+        {
+            //A value was sent since the timer was set, so the one held back now is due later.
+            sink->ScheduleFlush(now);
+            return;
+        }
+        try
+        {
+            sink->FlushPending();
+        }
+        catch (...)
+        {
+            //The window may already be gone, and the next call reports it to the caller.
+        }
+    }
+
+    void TaskbarProgressSink::FlushPending()
+    {
+        uint64_t completed, total;
+        if (throttle.TakePending(completed, total, Now()))
+        {
+            check_hresult(m_taskbarList->SetProgressValue(hwnd, completed, total));
+        }
+    }
+
+    void TaskbarProgressSink::ScheduleFlush(const uint64_t now)
+    {
+        uint64_t due;
+        if (isTimerSet || !timer || !throttle.GetPendingDue(due)) { return; }
+        LARGE_INTEGER dueTime{};
+        //Relative due times are negative and counted in 100 ns.
+        dueTime.QuadPart = -static_cast<int64_t>(due > now ? due - now : 0) * 10000;
+        FILETIME fileTime{ dueTime.LowPart, static_cast<DWORD>(dueTime.HighPart) };
+        SetThreadpoolTimer(timer, &fileTime, 0, 0);
+        isTimerSet = true;
+    }
+
+    void TaskbarProgressSink::CloseTimer()
+    {
+        if (!timer) { return; }
+        SetThreadpoolTimer(timer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(timer, TRUE);
+        CloseThreadpoolTimer(timer);
+        timer = nullptr;
+    }
+}
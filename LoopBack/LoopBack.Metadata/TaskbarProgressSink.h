@@ -0,0 +1,53 @@
+#pragma once
+
+#include "TaskbarProgressSink.g.h"
+#include "ProgressThrottle.h"
+#include <mutex>
+
+using namespace winrt;
+using namespace Windows::Foundation;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Sits in front of a TaskbarList, which may live in the elevated server, so fine-grained
+    // progress costs a call only when the visible percentage or the state changes, at most
+    // once per MinInterval. The final value and every state change are forwarded at once, and
+    // a value held back goes out when its interval is over, even if nothing follows it.
+    struct TaskbarProgressSink : TaskbarProgressSinkT<TaskbarProgressSink>
+    {
+        TaskbarProgressSink(const LoopBack::Metadata::TaskbarList& taskbarList, const uint64_t hwnd);
+        ~TaskbarProgressSink();
+
+        TimeSpan MinInterval();
+        void MinInterval(const TimeSpan& value);
+
+        void SetProgressState(const TaskbarProgressState& state);
+        void SetProgressValue(const uint64_t completed, const uint64_t total);
+        void Flush();
+        void Close();
+
+    private:
+        std::mutex lock;
+        com_ptr<ITaskbarList3> m_taskbarList;
+        HWND hwnd;
+        ProgressThrottle throttle;
+        TaskbarProgressState state = TaskbarProgressState::NoProgress;
+        bool hasState = false;
+        PTP_TIMER timer = nullptr;
+        bool isTimerSet = false;
+
+        static const uint64_t Now();
+        static void CALLBACK OnTimer(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_TIMER timer);
+        void FlushPending();
+        // Sets the timer to send the value held back once it is due, unless it is set already.
+        void ScheduleFlush(const uint64_t now);
+        void CloseTimer();
+    };
+}
+
+namespace winrt::LoopBack::Metadata::factory_implementation
+{
+    struct TaskbarProgressSink : TaskbarProgressSinkT<TaskbarProgressSink, implementation::TaskbarProgressSink>
+    {
+    };
+}
@@ -0,0 +1,122 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    void TimerWheel::Schedule(const wstring& key, const uint64_t deadline)
+    {
+        const uint64_t effective = max(deadline, current + 1);
+        //A replaced entry stays in its slot and is skipped when it fires.
+        deadlines[key] = effective;
+        Place({ key, effective });
+    }
+
+    const bool TimerWheel::Cancel(const wstring& key)
+    {
+        return deadlines.erase(key) != 0;
+    }
+
+    vector<wstring> TimerWheel::Advance(const uint64_t now)
+    {
+        vector<wstring> fired;
+        if (now <= current) { return fired; }
+
+        //Walking a long gap tick by tick would touch every empty slot, so it is cheaper to
+        //re-place every live entry once.
+        if (now - current >= SlotCount)
+        {
+            Rebuild(now, fired);
+            return fired;
+        }
+
+        while (current < now)
+        {
+            current++;
+            //Cascade the higher levels whose slot boundary was just crossed.
+            for (uint32_t level = 1; level < LevelCount; level++)
+            {
+                if (current & ((1ull << (SlotBits * level)) - 1)) { break; }
+                vector<Entry> slot = move(slots[level][(current >> (SlotBits * level)) & (SlotCount - 1)]);
+                for (Entry& entry : slot)
+                {
+                    Place(move(entry));
+                }
+                if (level == LevelCount - 1)
+                {
+                    vector<Entry> pending = move(overflow);
+                    for (Entry& entry : pending)
+                    {
+                        Place(move(entry));
+                    }
+                }
+            }
+            Fire(slots[0][current & (SlotCount - 1)], fired);
+        }
+
+        return fired;
+    }
+
+    void TimerWheel::Place(Entry&& entry)
+    {
+        const uint64_t delta = entry.Deadline - current;
+        for (uint32_t level = 0; level < LevelCount; level++)
+        {
+            if (delta < (1ull << (SlotBits * (level + 1))))
+            {
+                slots[level][(entry.Deadline >> (SlotBits * level)) & (SlotCount - 1)].push_back(move(entry));
+                return;
+            }
+        }
+        overflow.push_back(move(entry));
+    }
+
+    void TimerWheel::Fire(vector<Entry>& slot, vector<wstring>& fired)
+    {
+        for (Entry& entry : slot)
+        {
+            const auto item = deadlines.find(entry.Key);
+            if (item != deadlines.end() && item->second == entry.Deadline)
+            {
+                deadlines.erase(item);
+                fired.push_back(move(entry.Key));
+            }
+        }
+        slot.clear();
+    }
+
+    void TimerWheel::Rebuild(const uint64_t now, vector<wstring>& fired)
+    {
+        for (auto& level : slots)
+        {
+            for (vector<Entry>& slot : level)
+            {
+                slot.clear();
+            }
+        }
+        overflow.clear();
+        current = now;
+
+        vector<Entry> due;
+        for (auto item = deadlines.begin(); item != deadlines.end();)
+        {
+            if (item->second <= now)
+            {
+                due.push_back({ item->first, item->second });
+                item = deadlines.erase(item);
+            }
+            else
+            {
+                Place({ item->first, item->second });
+                ++item;
+            }
+        }
+
+        sort(due.begin(), due.end(), [](const Entry& left, const Entry& right) { return left.Deadline < right.Deadline; });
+        for (Entry& entry : due)
+        {
+            fired.push_back(move(entry.Key));
+        }
+    }
+}
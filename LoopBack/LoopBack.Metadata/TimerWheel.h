@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace winrt::LoopBack::Metadata::implementation
+{
+    // Hierarchical timer wheel over an abstract tick counter. Level n has SlotCount slots
+    // of SlotCount^n ticks each, so scheduling and firing cost O(1) per entry and entries
+    // only move down a level when their slot comes around. The caller drives the clock
+    // through Advance, which keeps the wheel free of any platform dependency.
+    struct TimerWheel
+    {
+        static constexpr uint32_t SlotBits = 6;
+        static constexpr uint32_t SlotCount = 1 << SlotBits;
+        static constexpr uint32_t LevelCount = 4;
+
+        explicit TimerWheel(const uint64_t now = 0) : current(now) {}
+
+        // Schedules key to fire at deadline, replacing any earlier schedule of the same key.
+        // A deadline that has already passed fires on the next tick.
+        void Schedule(const std::wstring& key, const uint64_t deadline);
+        const bool Cancel(const std::wstring& key);
+
+        // Moves the clock forward to now and returns the keys that fired, in deadline order.
+        std::vector<std::wstring> Advance(const uint64_t now);
+
+        const uint64_t Now() const { return current; }
+        const size_t Size() const { return deadlines.size(); }
+        const std::unordered_map<std::wstring, uint64_t>& Deadlines() const { return deadlines; }
+
+    private:
+        struct Entry
+        {
+            std::wstring Key;
+            uint64_t Deadline;
+        };
+
+        uint64_t current;
+        std::vector<Entry> slots[LevelCount][SlotCount];
+        std::vector<Entry> overflow;
+        std::unordered_map<std::wstring, uint64_t> deadlines;
+
+        void Place(Entry&& entry);
+        void Fire(std::vector<Entry>& slot, std::vector<std::wstring>& fired);
+        void Rebuild(const uint64_t now, std::vector<std::wstring>& fired);
+    };
+}
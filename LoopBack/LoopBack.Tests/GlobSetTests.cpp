@@ -0,0 +1,148 @@
+#include "GlobSet.h"
+#include "TestHelpers.h"
+#include <random>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // Textbook backtracking matcher the compiled patterns are checked against.
+    bool Reference(const wstring_view pattern, const wstring_view value)
+    {
+        if (pattern.empty()) { return value.empty(); }
+        if (pattern.front() == L'*')
+        {
+            for (size_t skip = 0; skip <= value.size(); skip++)
+            {
+                if (Reference(pattern.substr(1), value.substr(skip))) { return true; }
+            }
+            return false;
+        }
+        return !value.empty()
+            && (pattern.front() == L'?' || pattern.front() == value.front())
+            && Reference(pattern.substr(1), value.substr(1));
+    }
+
+    wstring RandomString(mt19937& random, const wstring_view alphabet, const size_t maxLength)
+    {
+        wstring result(uniform_int_distribution<size_t>(0, maxLength)(random), L' ');
+        for (wchar_t& c : result)
+        {
+            c = alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(random)];
+        }
+        return result;
+    }
+}
+
+TEST_CASE(MatchesLiteralsExactly)
+{
+    const GlobPattern pattern(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBWE");
+    CHECK(pattern.IsLiteral());
+    CHECK(pattern.Match(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBWE"));
+    CHECK(!pattern.Match(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBW"));
+    CHECK(!pattern.Match(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBWEX"));
+    CHECK(!pattern.Match(L""));
+}
+
+TEST_CASE(MatchesStarsAnywhere)
+{
+    CHECK(GlobPattern(L"*").Match(L""));
+    CHECK(GlobPattern(L"*").Match(L"ANYTHING"));
+    CHECK(GlobPattern(L"MICROSOFT.*").Match(L"MICROSOFT."));
+    CHECK(GlobPattern(L"MICROSOFT.*").Match(L"MICROSOFT.PHOTOS_8WEKYB3D8BBWE"));
+    CHECK(!GlobPattern(L"MICROSOFT.*").Match(L"MICROSOFT"));
+    CHECK(GlobPattern(L"*_8WEKYB3D8BBWE").Match(L"MICROSOFT.PHOTOS_8WEKYB3D8BBWE"));
+    CHECK(!GlobPattern(L"*_8WEKYB3D8BBWE").Match(L"MICROSOFT.PHOTOS_8WEKYB3D8BBWEX"));
+    CHECK(GlobPattern(L"*XBOX*").Match(L"MICROSOFT.XBOXAPP_8WEKYB3D8BBWE"));
+    CHECK(GlobPattern(L"A*B*C").Match(L"ABC"));
+    CHECK(GlobPattern(L"A*B*C").Match(L"AXXBYYBZZC"));
+    CHECK(!GlobPattern(L"A*B*C").Match(L"AXXCYYB"));
+    CHECK(GlobPattern(L"A**B").Match(L"AB"));
+}
+
+TEST_CASE(AnchorsDoNotOverlap)
+{
+    //The prefix and suffix of a value may not share characters.
+    CHECK(!GlobPattern(L"AB*BA").Match(L"ABA"));
+    CHECK(GlobPattern(L"AB*BA").Match(L"ABBA"));
+    CHECK(!GlobPattern(L"A*A").Match(L"A"));
+    CHECK(GlobPattern(L"A*A").Match(L"AA"));
+}
+
+TEST_CASE(MatchesQuestionMarksOnce)
+{
+    CHECK(GlobPattern(L"?").Match(L"X"));
+    CHECK(!GlobPattern(L"?").Match(L""));
+    CHECK(!GlobPattern(L"?").Match(L"XY"));
+    CHECK(GlobPattern(L"APP?_*").Match(L"APP1_PUBLISHER"));
+    CHECK(!GlobPattern(L"APP?_*").Match(L"APP_PUBLISHER"));
+    CHECK(GlobPattern(L"*?_X").Match(L"A_X"));
+    CHECK(!GlobPattern(L"*?_X").Match(L"_X"));
+}
+
+TEST_CASE(ExposesAnchors)
+{
+    CHECK(GlobPattern(L"MICROSOFT.*_8WEKYB3D8BBWE").Prefix() == L"MICROSOFT.");
+    CHECK(GlobPattern(L"MICROSOFT.*_8WEKYB3D8BBWE").Suffix() == L"_8WEKYB3D8BBWE");
+    CHECK(GlobPattern(L"APP?X*").Prefix() == L"APP");
+    CHECK(GlobPattern(L"APP?X*").Suffix().empty());
+    CHECK(GlobPattern(L"*X*").Prefix().empty());
+    CHECK(GlobPattern(L"*X*").Suffix().empty());
+}
+
+TEST_CASE(SetMatchesAnyOfItsPatterns)
+{
+    GlobSet set;
+    CHECK(set.Empty());
+    CHECK(!set.Match(L"ANYTHING"));
+
+    set.Add(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBWE");
+    set.Add(L"CONTOSO.*");
+    set.Add(L"*_PUBLISHER");
+    set.Add(L"*XBOX*");
+    CHECK(!set.Empty());
+
+    CHECK(set.Match(L"MICROSOFT.WINDOWSCALCULATOR_8WEKYB3D8BBWE"));
+    CHECK(set.Match(L"CONTOSO.APP_1234"));
+    CHECK(set.Match(L"FABRIKAM.APP_PUBLISHER"));
+    CHECK(set.Match(L"MICROSOFT.XBOXAPP_8WEKYB3D8BBWE"));
+    CHECK(!set.Match(L"MICROSOFT.PHOTOS_8WEKYB3D8BBWE"));
+    CHECK(!set.Match(L"CONTOSO"));
+
+    set.Clear();
+    CHECK(set.Empty());
+    CHECK(!set.Match(L"CONTOSO.APP_1234"));
+}
+
+TEST_CASE(SetAgreesWithReferenceMatcher)
+{
+    //A small alphabet makes anchors collide, so candidates sharing an anchor are exercised too.
+    mt19937 random(20261018);
+    for (int round = 0; round < 200; round++)
+    {
+        vector<wstring> patterns;
+        GlobSet set;
+        const size_t count = uniform_int_distribution<size_t>(1, 40)(random);
+        for (size_t i = 0; i < count; i++)
+        {
+            patterns.push_back(RandomString(random, L"AB*?", 6));
+            set.Add(patterns.back());
+        }
+
+        for (int probe = 0; probe < 50; probe++)
+        {
+            const wstring value = RandomString(random, L"ABC", 8);
+            bool expected = false;
+            for (const wstring& pattern : patterns)
+            {
+                const bool isMatched = Reference(pattern, value);
+                CHECK(GlobPattern(pattern).Match(value) == isMatched);
+                expected = expected || isMatched;
+            }
+            CHECK(set.Match(value) == expected);
+        }
+    }
+}
+
+TEST_MAIN()
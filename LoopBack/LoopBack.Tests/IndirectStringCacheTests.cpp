@@ -0,0 +1,156 @@
+#include "IndirectStringCache.h"
+#include "TestHelpers.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // Stands in for SHLoadIndirectString: every reference resolves to a value derived from
+    // it, except those naming a missing package. Calls and their concurrency are counted.
+    struct FakeResolver
+    {
+        atomic<int> Calls = 0;
+        atomic<int> Running = 0;
+        atomic<int> MaxRunning = 0;
+        chrono::milliseconds Delay = chrono::milliseconds(0);
+
+        IndirectStringCache::Resolver Get()
+        {
+            return [this](const wstring_view reference) -> optional<wstring>
+                {
+                    Calls++;
+                    const int running = ++Running;
+                    int current = MaxRunning;
+                    while (running > current && !MaxRunning.compare_exchange_weak(current, running))
+                    {
+                    }
+                    this_thread::sleep_for(Delay);
+                    Running--;
+                    if (reference.find(L"Missing") != wstring_view::npos) { return nullopt; }
+                    return L"Resolved " + wstring(reference.substr(2, reference.find(L'?') - 2));
+                };
+        }
+    };
+
+    // A cache file of its own for every test, removed afterwards.
+    struct TemporaryPath
+    {
+        filesystem::path Path;
+
+        explicit TemporaryPath(const char* name) : Path(filesystem::temp_directory_path() / (string("LoopBack.") + name + ".cache"))
+        {
+            filesystem::remove(Path);
+        }
+
+        ~TemporaryPath()
+        {
+            filesystem::remove(Path);
+        }
+    };
+
+    const wstring Reference(const wstring_view package, const int index = 0)
+    {
+        return L"@{" + wstring(package) + L"?ms-resource://" + wstring(package) + L"/Resources/Name" + to_wstring(index) + L"}";
+    }
+}
+
+TEST_CASE(ResolvesEachReferenceOnce)
+{
+    FakeResolver resolver;
+    IndirectStringCache cache(resolver.Get(), {});
+
+    cache.Prefetch({ Reference(L"Contoso.App"), Reference(L"Contoso.App"), Reference(L"Fabrikam.App") });
+    CHECK(resolver.Calls == 2);
+    CHECK(cache.Resolve(Reference(L"Contoso.App")) == L"Resolved Contoso.App");
+    CHECK(cache.Resolve(Reference(L"Fabrikam.App")) == L"Resolved Fabrikam.App");
+
+    cache.Prefetch({ Reference(L"Contoso.App"), Reference(L"Fabrikam.App") });
+    CHECK(resolver.Calls == 2);
+}
+
+TEST_CASE(PlainAndUnresolvedValuesPassThrough)
+{
+    FakeResolver resolver;
+    IndirectStringCache cache(resolver.Get(), {});
+
+    cache.Prefetch({ L"Plain name", Reference(L"Missing.App") });
+    CHECK(resolver.Calls == 1);
+    CHECK(cache.Resolve(L"Plain name") == L"Plain name");
+    CHECK(cache.Resolve(Reference(L"Missing.App")) == Reference(L"Missing.App"));
+    CHECK(cache.Resolve(Reference(L"Unknown.App")) == Reference(L"Unknown.App"));
+
+    //A failure is not retried until the resolver changes.
+    cache.Prefetch({ Reference(L"Missing.App") });
+    CHECK(resolver.Calls == 1);
+    FakeResolver replacement;
+    cache.SetResolver(replacement.Get());
+    cache.Prefetch({ Reference(L"Missing.App") });
+    CHECK(replacement.Calls == 1);
+}
+
+TEST_CASE(ResolvesNewReferencesInParallel)
+{
+    FakeResolver resolver;
+    resolver.Delay = chrono::milliseconds(5);
+    IndirectStringCache cache(resolver.Get(), {});
+
+    vector<wstring> references;
+    for (int i = 0; i < 64; i++)
+    {
+        references.push_back(Reference(L"Contoso.App", i));
+    }
+    cache.Prefetch(references);
+
+    CHECK(resolver.Calls == 64);
+    if (thread::hardware_concurrency() > 1)
+    {
+        CHECK(resolver.MaxRunning > 1);
+    }
+    for (const wstring& reference : references)
+    {
+        CHECK(cache.Resolve(reference) == L"Resolved Contoso.App");
+    }
+}
+
+TEST_CASE(ResolvedValuesSurviveARestart)
+{
+    const TemporaryPath file("Restart");
+    {
+        FakeResolver resolver;
+        IndirectStringCache cache(resolver.Get(), file.Path);
+        cache.Prefetch({ Reference(L"Contoso.App"), Reference(L"Missing.App") });
+        CHECK(filesystem::exists(file.Path));
+    }
+
+    FakeResolver resolver;
+    IndirectStringCache cache(resolver.Get(), file.Path);
+    cache.Prefetch({ Reference(L"Contoso.App") });
+    CHECK(resolver.Calls == 0);
+    CHECK(cache.Resolve(Reference(L"Contoso.App")) == L"Resolved Contoso.App");
+
+    //Failures are kept in memory only, so the next server tries again.
+    cache.Prefetch({ Reference(L"Missing.App") });
+    CHECK(resolver.Calls == 1);
+}
+
+TEST_CASE(DamagedCacheFileIsIgnored)
+{
+    const TemporaryPath file("Damaged");
+    {
+        ofstream stream(file.Path, ios::binary);
+        stream << "not a cache";
+    }
+
+    FakeResolver resolver;
+    IndirectStringCache cache(resolver.Get(), file.Path);
+    cache.Prefetch({ Reference(L"Contoso.App") });
+    CHECK(resolver.Calls == 1);
+    CHECK(cache.Resolve(Reference(L"Contoso.App")) == L"Resolved Contoso.App");
+}
+
+TEST_MAIN()
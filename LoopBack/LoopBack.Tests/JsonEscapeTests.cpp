@@ -0,0 +1,100 @@
+#include "JsonEscape.h"
+#include "TestHelpers.h"
+#include <random>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // One byte at a time, the way the escaper has to behave whichever path it takes.
+    string Reference(const string_view value)
+    {
+        string result;
+        char code[8];
+        for (const char item : value)
+        {
+            const unsigned char c = static_cast<unsigned char>(item);
+            switch (c)
+            {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (c < 0x20)
+                {
+                    snprintf(code, sizeof(code), "\\u%04x", c);
+                    result += code;
+                }
+                else
+                {
+                    result.push_back(item);
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    string Escape(const string_view value)
+    {
+        string result;
+        EscapeJson(value, result);
+        return result;
+    }
+}
+
+TEST_CASE(CopiesPlainText)
+{
+    CHECK(Escape("") == "");
+    CHECK(Escape("Microsoft.WindowsStore_8wekyb3d8bbwe") == "Microsoft.WindowsStore_8wekyb3d8bbwe");
+    CHECK(Escape("C:\\Program Files\\WindowsApps") == "C:\\\\Program Files\\\\WindowsApps");
+}
+
+TEST_CASE(EscapesQuotesAndControlCharacters)
+{
+    CHECK(Escape("say \"hi\"") == "say \\\"hi\\\"");
+    CHECK(Escape("a\tb\r\nc") == "a\\tb\\r\\nc");
+    CHECK(Escape(string_view("\0\x1f\b\f", 4)) == "\\u0000\\u001f\\b\\f");
+    //DEL and UTF-8 continuation bytes are not escaped.
+    CHECK(Escape("\x7f\xc3\xa9") == "\x7f\xc3\xa9");
+}
+
+TEST_CASE(FindsSpecialCharactersAtEveryPositionOfAChunk)
+{
+    //The vectorized scan works in 16 byte chunks, so every offset within and across them is tried.
+    for (size_t length = 1; length <= 48; length++)
+    {
+        for (size_t position = 0; position < length; position++)
+        {
+            for (const char special : { '"', '\\', '\n', '\x01' })
+            {
+                string value(length, 'x');
+                value[position] = special;
+                CHECK(Escape(value) == Reference(value));
+            }
+        }
+    }
+}
+
+TEST_CASE(MatchesTheReferenceOnRandomInput)
+{
+    mt19937 random(7);
+    for (int i = 0; i < 2000; i++)
+    {
+        string value(uniform_int_distribution<size_t>(0, 100)(random), ' ');
+        for (char& c : value)
+        {
+            //Mostly printable text with the occasional byte that needs escaping.
+            const uint32_t roll = random() % 32;
+            c = roll == 0 ? static_cast<char>(random() % 0x20) : roll == 1 ? '"' : roll == 2 ? '\\' : static_cast<char>(0x20 + random() % 0xE0);
+        }
+        CHECK(Escape(value) == Reference(value));
+    }
+}
+
+TEST_MAIN()
@@ -0,0 +1,171 @@
+#include "ProgressThrottle.h"
+#include "TestHelpers.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    struct Update
+    {
+        uint64_t Completed;
+        uint64_t Total;
+    };
+
+    // Drives a throttle the way TaskbarProgressSink does: every step is offered, the
+    // values it lets through are sent, and whatever is held back goes out with the flush
+    // or when the timer finds it due.
+    struct FakeSink
+    {
+        ProgressThrottle Throttle;
+        vector<Update> Sent;
+
+        explicit FakeSink(const uint64_t minInterval) : Throttle(minInterval) {}
+
+        void SetProgressValue(const uint64_t completed, const uint64_t total, const uint64_t now)
+        {
+            if (Throttle.Offer(completed, total, now))
+            {
+                Sent.push_back({ completed, total });
+            }
+        }
+
+        void Flush(const uint64_t now)
+        {
+            uint64_t completed = 0;
+            uint64_t total = 0;
+            if (Throttle.TakePending(completed, total, now))
+            {
+                Sent.push_back({ completed, total });
+            }
+        }
+
+        void OnTimer(const uint64_t now)
+        {
+            uint64_t due = 0;
+            if (Throttle.GetPendingDue(due) && now >= due)
+            {
+                Flush(now);
+            }
+        }
+    };
+
+    constexpr uint64_t StepCount = 100000;
+
+    const bool IsMonotonic(const vector<Update>& updates)
+    {
+        for (size_t i = 1; i < updates.size(); i++)
+        {
+            if (updates[i].Completed < updates[i - 1].Completed) { return false; }
+        }
+        return true;
+    }
+}
+
+TEST_CASE(HundredThousandStepsAtOnceSendFirstAndFinal)
+{
+    FakeSink sink(50);
+    for (uint64_t i = 1; i <= StepCount; i++)
+    {
+        sink.SetProgressValue(i, StepCount, 0);
+    }
+    sink.Flush(0);
+
+    CHECK(sink.Sent.size() <= 2);
+    CHECK(!sink.Sent.empty());
+    CHECK(sink.Sent.back().Completed == StepCount);
+}
+
+TEST_CASE(HundredThousandStepsAreBoundedByVisiblePercentages)
+{
+    //Every step lands a full interval after the last, so only the percentage can drop values.
+    FakeSink sink(50);
+    uint64_t now = 0;
+    for (uint64_t i = 1; i <= StepCount; i++)
+    {
+        sink.SetProgressValue(i, StepCount, now);
+        now += 50;
+    }
+    sink.Flush(now);
+
+    CHECK(sink.Sent.size() <= 101);
+    CHECK(sink.Sent.size() >= 100);
+    CHECK(IsMonotonic(sink.Sent));
+    CHECK(sink.Sent.back().Completed == StepCount);
+}
+
+TEST_CASE(HundredThousandStepsAreBoundedByInterval)
+{
+    //A microsecond clock scaled to milliseconds: the whole run takes 100 ms, so the
+    //interval, not the percentage, is what limits the calls.
+    FakeSink sink(50);
+    for (uint64_t i = 1; i <= StepCount; i++)
+    {
+        sink.SetProgressValue(i, StepCount, i / 1000);
+    }
+    sink.Flush(StepCount / 1000);
+
+    CHECK(sink.Sent.size() <= 4);
+    CHECK(IsMonotonic(sink.Sent));
+    CHECK(sink.Sent.back().Completed == StepCount);
+}
+
+TEST_CASE(FlushSendsTheValueHeldBack)
+{
+    FakeSink sink(50);
+    sink.SetProgressValue(10, 100, 0);
+    sink.SetProgressValue(20, 100, 10);
+    sink.SetProgressValue(30, 100, 20);
+    CHECK(sink.Sent.size() == 1);
+
+    sink.Flush(30);
+    CHECK(sink.Sent.size() == 2);
+    CHECK(sink.Sent.back().Completed == 30);
+
+    //Nothing is left to flush once the held value went out.
+    sink.Flush(40);
+    CHECK(sink.Sent.size() == 2);
+}
+
+TEST_CASE(HeldBackValueIsDueOneIntervalAfterTheLastSent)
+{
+    //Nothing follows the last value, so only the timer can send it.
+    FakeSink sink(50);
+    sink.SetProgressValue(10, 100, 0);
+    sink.SetProgressValue(20, 100, 10);
+    uint64_t due = 0;
+    CHECK(sink.Throttle.GetPendingDue(due));
+    CHECK(due == 50);
+
+    sink.OnTimer(49);
+    CHECK(sink.Sent.size() == 1);
+    sink.OnTimer(50);
+    CHECK(sink.Sent.size() == 2);
+    CHECK(sink.Sent.back().Completed == 20);
+    CHECK(!sink.Throttle.GetPendingDue(due));
+}
+
+TEST_CASE(RepeatedValueIsDroppedAndResetSendsAgain)
+{
+    FakeSink sink(0);
+    sink.SetProgressValue(5, 10, 0);
+    sink.SetProgressValue(5, 10, 100);
+    CHECK(sink.Sent.size() == 1);
+
+    sink.Throttle.Reset();
+    sink.SetProgressValue(5, 10, 200);
+    CHECK(sink.Sent.size() == 2);
+}
+
+TEST_CASE(FinalValueIsNeverHeldBack)
+{
+    FakeSink sink(1000);
+    sink.SetProgressValue(1, 3, 0);
+    sink.SetProgressValue(3, 3, 1);
+    CHECK(sink.Sent.size() == 2);
+    CHECK(sink.Sent.back().Completed == 3);
+}
+
+TEST_MAIN()
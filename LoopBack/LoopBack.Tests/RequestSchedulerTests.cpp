@@ -0,0 +1,245 @@
+#include "RequestScheduler.h"
+#include "TestHelpers.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // Ranks in the order of the RequestClass enum of the server.
+    enum class RequestClass : size_t
+    {
+        InteractiveRead,
+        InteractiveWrite,
+        BackgroundRefresh,
+        Bulk
+    };
+
+    constexpr uint64_t AgingInterval = 1000;
+
+    // A scheduler on a virtual clock with a turn held by a blocker thread, so requests can be
+    // queued in a known order and released together.
+    struct Harness
+    {
+        atomic<uint64_t> Now = 0;
+        RequestScheduler Scheduler{ [this]() { return Now.load(); }, AgingInterval };
+        mutex OrderLock;
+        vector<string> Order;
+        atomic<bool> IsHolding = false;
+        atomic<bool> IsReleased = false;
+        vector<thread> Threads;
+
+        Harness()
+        {
+            Threads.emplace_back([this]()
+                {
+                    Scheduler.Run(RequestClass::InteractiveWrite, [this]()
+                        {
+                            IsHolding = true;
+                            while (!IsReleased) { this_thread::yield(); }
+                        });
+                });
+            while (!IsHolding) { this_thread::yield(); }
+        }
+
+        ~Harness()
+        {
+            IsReleased = true;
+            for (thread& item : Threads) { item.join(); }
+        }
+
+        void Queue(const RequestClass requestClass, const string& name)
+        {
+            const uint32_t depth = Scheduler.GetMetrics()[static_cast<size_t>(requestClass)].QueueDepth;
+            Threads.emplace_back([this, requestClass, name]()
+                {
+                    Scheduler.Run(requestClass, [this, name]()
+                        {
+                            const lock_guard<mutex> guard(OrderLock);
+                            Order.push_back(name);
+                        });
+                });
+            //Keys are taken from the clock when a request is queued, so wait until it is.
+            while (Scheduler.GetMetrics()[static_cast<size_t>(requestClass)].QueueDepth == depth) { this_thread::yield(); }
+        }
+
+        vector<string> Finish()
+        {
+            IsReleased = true;
+            for (thread& item : Threads) { item.join(); }
+            Threads.clear();
+            return Order;
+        }
+    };
+}
+
+TEST_CASE(HigherClassesGoFirst)
+{
+    Harness harness;
+    harness.Queue(RequestClass::Bulk, "bulk");
+    harness.Queue(RequestClass::BackgroundRefresh, "refresh");
+    harness.Queue(RequestClass::InteractiveWrite, "write");
+    harness.Queue(RequestClass::InteractiveRead, "read");
+    CHECK((harness.Finish() == vector<string>{ "read", "write", "refresh", "bulk" }));
+}
+
+TEST_CASE(EqualClassesGoInArrivalOrder)
+{
+    Harness harness;
+    harness.Queue(RequestClass::InteractiveWrite, "first");
+    harness.Queue(RequestClass::InteractiveWrite, "second");
+    harness.Queue(RequestClass::InteractiveWrite, "third");
+    CHECK((harness.Finish() == vector<string>{ "first", "second", "third" }));
+}
+
+TEST_CASE(WaitingRequestsAge)
+{
+    Harness harness;
+    harness.Queue(RequestClass::Bulk, "bulk");
+    //A read that arrives three aging intervals later ranks below the bulk job queued first.
+    harness.Now = 3 * AgingInterval + 1;
+    harness.Queue(RequestClass::InteractiveRead, "late read");
+    harness.Now = 3 * AgingInterval - 1;
+    harness.Queue(RequestClass::InteractiveRead, "early read");
+    CHECK((harness.Finish() == vector<string>{ "early read", "bulk", "late read" }));
+}
+
+TEST_CASE(NestedRunsKeepTheTurn)
+{
+    RequestScheduler scheduler([]() { return uint64_t(0); }, AgingInterval);
+    vector<int> order;
+    scheduler.Run(RequestClass::Bulk, [&]()
+        {
+            order.push_back(1);
+            scheduler.Run(RequestClass::InteractiveWrite, [&]() { order.push_back(2); });
+            scheduler.Admit(RequestClass::InteractiveRead);
+            order.push_back(3);
+        });
+    CHECK((order == vector<int>{ 1, 2, 3 }));
+    CHECK(scheduler.GetMetrics()[static_cast<size_t>(RequestClass::Bulk)].Completed == 1);
+    CHECK(scheduler.GetMetrics()[static_cast<size_t>(RequestClass::InteractiveWrite)].Completed == 0);
+}
+
+TEST_CASE(ReleasesTheTurnOnExceptions)
+{
+    RequestScheduler scheduler([]() { return uint64_t(0); }, AgingInterval);
+    CHECK_THROWS(scheduler.Run(RequestClass::InteractiveWrite, []() { throw runtime_error("commit failed"); }));
+    bool isRun = false;
+    scheduler.Run(RequestClass::InteractiveWrite, [&]() { isRun = true; });
+    CHECK(isRun);
+    CHECK(scheduler.GetMetrics()[static_cast<size_t>(RequestClass::InteractiveWrite)].Completed == 2);
+}
+
+TEST_CASE(ChunkedJobsYieldToHigherClasses)
+{
+    RequestScheduler scheduler([]() { return uint64_t(0); }, AgingInterval);
+    mutex orderLock;
+    vector<string> order;
+    thread writer;
+    scheduler.RunChunked(RequestClass::Bulk, 3, [&](const size_t index)
+        {
+            {
+                const lock_guard<mutex> guard(orderLock);
+                order.push_back("bulk " + to_string(index));
+            }
+            if (index == 0)
+            {
+                writer = thread([&]()
+                    {
+                        scheduler.Run(RequestClass::InteractiveWrite, [&]()
+                            {
+                                const lock_guard<mutex> guard(orderLock);
+                                order.push_back("write");
+                            });
+                    });
+                while (scheduler.GetMetrics()[static_cast<size_t>(RequestClass::InteractiveWrite)].QueueDepth == 0) { this_thread::yield(); }
+            }
+            return true;
+        });
+    writer.join();
+    CHECK((order == vector<string>{ "bulk 0", "write", "bulk 1", "bulk 2" }));
+    CHECK(scheduler.GetMetrics()[static_cast<size_t>(RequestClass::Bulk)].Completed == 1);
+}
+
+TEST_CASE(ChunkedJobsKeepTheirAging)
+{
+    atomic<uint64_t> now = 0;
+    RequestScheduler scheduler([&]() { return now.load(); }, AgingInterval);
+    mutex orderLock;
+    vector<string> order;
+    thread reader;
+    scheduler.RunChunked(RequestClass::Bulk, 2, [&](const size_t index)
+        {
+            {
+                const lock_guard<mutex> guard(orderLock);
+                order.push_back("bulk " + to_string(index));
+            }
+            if (index == 0)
+            {
+                //The job was queued long before this read, so it keeps the turn.
+                now = 3 * AgingInterval + 1;
+                reader = thread([&]()
+                    {
+                        scheduler.Run(RequestClass::InteractiveRead, [&]()
+                            {
+                                const lock_guard<mutex> guard(orderLock);
+                                order.push_back("late read");
+                            });
+                    });
+                while (scheduler.GetMetrics()[static_cast<size_t>(RequestClass::InteractiveRead)].QueueDepth == 0) { this_thread::yield(); }
+            }
+            return true;
+        });
+    reader.join();
+    CHECK((order == vector<string>{ "bulk 0", "bulk 1", "late read" }));
+}
+
+TEST_CASE(ChunkedJobsStopAtFailedChunks)
+{
+    RequestScheduler scheduler([]() { return uint64_t(0); }, AgingInterval);
+    vector<size_t> chunks;
+    scheduler.RunChunked(RequestClass::Bulk, 5, [&](const size_t index)
+        {
+            chunks.push_back(index);
+            return index < 1;
+        });
+    CHECK((chunks == vector<size_t>{ 0, 1 }));
+
+    //Nested in a turn, the chunks run inline.
+    chunks.clear();
+    scheduler.Run(RequestClass::InteractiveWrite, [&]()
+        {
+            scheduler.RunChunked(RequestClass::Bulk, 3, [&](const size_t index)
+                {
+                    chunks.push_back(index);
+                    return true;
+                });
+        });
+    CHECK((chunks == vector<size_t>{ 0, 1, 2 }));
+    CHECK(scheduler.GetMetrics()[static_cast<size_t>(RequestClass::Bulk)].Completed == 1);
+}
+
+TEST_CASE(MeasuresWaitsOnTheClock)
+{
+    Harness harness;
+    harness.Now = 100;
+    harness.Queue(RequestClass::Bulk, "bulk");
+    harness.Now = 350;
+    harness.Finish();
+
+    const auto metrics = harness.Scheduler.GetMetrics();
+    const RequestScheduler::ClassMetrics& bulk = metrics[static_cast<size_t>(RequestClass::Bulk)];
+    CHECK(bulk.QueueDepth == 0);
+    CHECK(bulk.Completed == 1);
+    CHECK(bulk.TotalWait == 250);
+    CHECK(bulk.MaxWait == 250);
+}
+
+TEST_MAIN()
@@ -0,0 +1,146 @@
+#include "SnapshotSection.h"
+#include "TestHelpers.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // Stands in for the mapped section, aligned the way a mapping is.
+    struct Mapping
+    {
+        vector<uint64_t> Storage;
+
+        explicit Mapping(const size_t size) : Storage(size / sizeof(uint64_t))
+        {
+            SnapshotSection::Initialize(Base(), size);
+        }
+
+        void* Base() { return Storage.data(); }
+    };
+
+    // Publishes length bytes that all hold value, so a torn read shows up as mixed bytes.
+    const bool PublishFilled(void* base, const size_t length, const uint8_t value)
+    {
+        return SnapshotSection::Publish(base, length, [&](uint8_t* target) { fill(target, target + length, value); });
+    }
+
+    const bool IsFilled(const uint8_t* buffer, const size_t length, uint8_t& value)
+    {
+        if (length == 0) { return false; }
+        value = buffer[0];
+        return all_of(buffer, buffer + length, [&](const uint8_t item) { return item == value; });
+    }
+}
+
+TEST_CASE(ReadsNothingBeforeThePublish)
+{
+    Mapping mapping(64 * 1024);
+    bool isCalled = false;
+    CHECK(SnapshotSection::Read(mapping.Base(), [&](const uint8_t*, size_t) { isCalled = true; return true; }) == 0);
+    CHECK(!isCalled);
+
+    const uint8_t* buffer = nullptr;
+    size_t length = 0;
+    CHECK(SnapshotSection::BeginRead(mapping.Base(), buffer, length) == 0);
+}
+
+TEST_CASE(ReadsWhatWasPublished)
+{
+    Mapping mapping(64 * 1024);
+    CHECK(PublishFilled(mapping.Base(), 100, 7));
+
+    size_t readLength = 0;
+    uint8_t value = 0;
+    const uint64_t version = SnapshotSection::Read(mapping.Base(), [&](const uint8_t* buffer, const size_t length)
+        {
+            readLength = length;
+            return IsFilled(buffer, length, value);
+        });
+    CHECK(version == 2);
+    CHECK(readLength == 100);
+    CHECK(value == 7);
+
+    CHECK(PublishFilled(mapping.Base(), 50, 9));
+    CHECK(SnapshotSection::Read(mapping.Base(), [&](const uint8_t* buffer, const size_t length) { return IsFilled(buffer, length, value); }) == 4);
+    CHECK(value == 9);
+}
+
+TEST_CASE(RejectsWhatDoesNotFit)
+{
+    Mapping mapping(64 * 1024);
+    CHECK(PublishFilled(mapping.Base(), 10, 1));
+    const size_t capacity = static_cast<size_t>(SnapshotSection::GetHeader(mapping.Base())->Capacity);
+    CHECK(!PublishFilled(mapping.Base(), capacity + 1, 2));
+
+    //The previous version stays current.
+    uint8_t value = 0;
+    CHECK(SnapshotSection::Read(mapping.Base(), [&](const uint8_t* buffer, const size_t length) { return IsFilled(buffer, length, value); }) == 2);
+    CHECK(value == 1);
+    CHECK(PublishFilled(mapping.Base(), capacity, 3));
+}
+
+TEST_CASE(InPlaceReadsLastUntilTheNextPublish)
+{
+    Mapping mapping(64 * 1024);
+    CHECK(PublishFilled(mapping.Base(), 32, 5));
+
+    const uint8_t* buffer = nullptr;
+    size_t length = 0;
+    const uint64_t version = SnapshotSection::BeginRead(mapping.Base(), buffer, length);
+    CHECK(version == 2);
+    CHECK(length == 32);
+    uint8_t value = 0;
+    CHECK(IsFilled(buffer, length, value) && value == 5);
+    CHECK(SnapshotSection::IsCurrent(mapping.Base(), version));
+
+    CHECK(PublishFilled(mapping.Base(), 32, 6));
+    CHECK(!SnapshotSection::IsCurrent(mapping.Base(), version));
+    CHECK(SnapshotSection::BeginRead(mapping.Base(), buffer, length) == 4);
+}
+
+TEST_CASE(ValidatedReadsAreNeverTorn)
+{
+    Mapping mapping(256 * 1024);
+    CHECK(PublishFilled(mapping.Base(), 4096, 0));
+
+    atomic<bool> isDone = false;
+    thread publisher([&]()
+        {
+            for (uint32_t i = 1; i <= 20000; i++)
+            {
+                PublishFilled(mapping.Base(), 1024 + (i % 8) * 1024, static_cast<uint8_t>(i));
+            }
+            isDone = true;
+        });
+
+    uint32_t torn = 0;
+    uint32_t reads = 0;
+    //A loaded machine may run the whole publisher first, so reading goes on until one succeeded.
+    while (!isDone || !reads)
+    {
+        uint8_t value = 0;
+        if (SnapshotSection::Read(mapping.Base(), [&](const uint8_t* buffer, const size_t length) { return IsFilled(buffer, length, value); }))
+        {
+            reads++;
+        }
+
+        const uint8_t* buffer = nullptr;
+        size_t length = 0;
+        if (const uint64_t version = SnapshotSection::BeginRead(mapping.Base(), buffer, length))
+        {
+            const bool isFilled = IsFilled(buffer, length, value);
+            //A torn in-place read must always be caught by the version check.
+            if (!isFilled && SnapshotSection::IsCurrent(mapping.Base(), version)) { torn++; }
+        }
+    }
+    publisher.join();
+
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+}
+
+TEST_MAIN()
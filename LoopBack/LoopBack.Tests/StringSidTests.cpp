@@ -0,0 +1,79 @@
+#include "StringSid.h"
+#include "TestHelpers.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    const vector<uint8_t> Parse(const wstring_view stringSid)
+    {
+        uint8_t buffer[MaxSidSize] = {};
+        const uint32_t length = ParseStringSid(stringSid, buffer);
+        return vector<uint8_t>(buffer, buffer + length);
+    }
+
+    const vector<uint8_t> Sid(const uint64_t authority, const vector<uint32_t>& subAuthorities)
+    {
+        vector<uint8_t> result = { 1, static_cast<uint8_t>(subAuthorities.size()) };
+        for (int i = 5; i >= 0; i--)
+        {
+            result.push_back(static_cast<uint8_t>(authority >> (8 * i)));
+        }
+        for (const uint32_t value : subAuthorities)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            result.insert(result.end(), bytes, bytes + sizeof(value));
+        }
+        return result;
+    }
+}
+
+TEST_CASE(ParsesWellKnownSids)
+{
+    CHECK(Parse(L"S-1-5-18") == Sid(5, { 18 }));
+    CHECK(Parse(L"S-1-5-32-544") == Sid(5, { 32, 544 }));
+    CHECK(Parse(L"s-1-1-0") == Sid(1, { 0 }));
+    CHECK(Parse(L"S-1-5") == Sid(5, {}));
+}
+
+TEST_CASE(ParsesAppContainerSids)
+{
+    const wstring stringSid = L"S-1-15-2-1861897761-1695161497-2927542615-642690995-327840285-2659745135-2630312742";
+    CHECK(Parse(stringSid) == Sid(15, { 2, 1861897761u, 1695161497u, 2927542615u, 642690995u, 327840285u, 2659745135u, 2630312742u }));
+}
+
+TEST_CASE(ParsesHexAndLimits)
+{
+    CHECK(Parse(L"S-1-0x123456789ABC-0xffffffff") == Sid(0x123456789ABCull, { 0xFFFFFFFFu }));
+    CHECK(Parse(L"S-1-281474976710655-4294967295") == Sid(0xFFFFFFFFFFFFull, { 0xFFFFFFFFu }));
+    CHECK(Parse(L"S-1-281474976710656-1").empty());
+    CHECK(Parse(L"S-1-5-4294967296").empty());
+}
+
+TEST_CASE(AcceptsFifteenSubAuthorities)
+{
+    wstring stringSid = L"S-1-5";
+    vector<uint32_t> subAuthorities;
+    for (uint32_t i = 1; i <= 15; i++)
+    {
+        stringSid += L"-" + to_wstring(i);
+        subAuthorities.push_back(i);
+    }
+    CHECK(Parse(stringSid) == Sid(5, subAuthorities));
+    CHECK(Parse(stringSid).size() == MaxSidSize);
+    CHECK(Parse(stringSid + L"-16").empty());
+}
+
+TEST_CASE(RejectsEverythingElse)
+{
+    for (const wstring_view value : { L"", L"S", L"S-", L"S-1", L"S-2-5-18", L"S-1-5-", L"S-1-5--18", L"S-1-5-18-",
+        L"S-1-5-1x", L"S-1-0x-1", L"S-1-5-0xG", L"X-1-5-18", L"S-1-5-18 ", L"garbage", L"BA", L"SY" })
+    {
+        CHECK(Parse(value).empty());
+    }
+}
+
+TEST_MAIN()
@@ -0,0 +1,122 @@
+#include "SupervisedCall.h"
+#include "TestHelpers.h"
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+using namespace std::chrono_literals;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // Stands in for FirewallAPI: every call sleeps for the injected delay, or blocks until
+    // released when it is set to hang.
+    struct FakeBackend
+    {
+        chrono::milliseconds Delay = 0ms;
+        bool IsHung = false;
+        atomic<int> Calls = 0;
+
+        int Enumerate()
+        {
+            const int call = ++Calls;
+            if (IsHung)
+            {
+                unique_lock<mutex> guard(lock);
+                released.wait(guard, [this]() { return isReleased; });
+            }
+            this_thread::sleep_for(Delay);
+            return call;
+        }
+
+        void Release()
+        {
+            {
+                const lock_guard<mutex> guard(lock);
+                isReleased = true;
+            }
+            released.notify_all();
+        }
+
+    private:
+        mutex lock;
+        condition_variable released;
+        bool isReleased = false;
+    };
+}
+
+TEST_CASE(CompletesWithinDeadline)
+{
+    const shared_ptr<FakeBackend> backend = make_shared<FakeBackend>();
+    backend->Delay = 10ms;
+    const auto call = SupervisedCall<int>::Start([backend]() { return backend->Enumerate(); });
+
+    CHECK(call->Wait(5s));
+    CHECK(call->IsCompleted());
+    CHECK(call->Get() == 1);
+}
+
+TEST_CASE(TimesOutOnSlowBackendAndCanBeJoinedLater)
+{
+    const shared_ptr<FakeBackend> backend = make_shared<FakeBackend>();
+    backend->Delay = 300ms;
+    const auto call = SupervisedCall<int>::Start([backend]() { return backend->Enumerate(); });
+
+    const auto started = chrono::steady_clock::now();
+    CHECK(!call->Wait(20ms));
+    CHECK(chrono::steady_clock::now() - started < 250ms);
+    CHECK(!call->IsCompleted());
+
+    //A later caller attaches to the same call instead of starting another one.
+    CHECK(call->Wait(5s));
+    CHECK(call->Get() == 1);
+    CHECK(backend->Calls == 1);
+}
+
+TEST_CASE(AbandonedHungCallDoesNotBlockLaterCalls)
+{
+    const shared_ptr<FakeBackend> hung = make_shared<FakeBackend>();
+    hung->IsHung = true;
+    const auto abandoned = SupervisedCall<int>::Start([hung]() { return hung->Enumerate(); });
+    CHECK(!abandoned->Wait(20ms));
+
+    const shared_ptr<FakeBackend> backend = make_shared<FakeBackend>();
+    const auto call = SupervisedCall<int>::Start([backend]() { return backend->Enumerate(); });
+    CHECK(call->Wait(5s));
+    CHECK(call->Get() == 1);
+    CHECK(!abandoned->IsCompleted());
+
+    //The abandoned call still finishes on its own thread once the backend answers.
+    hung->Release();
+    CHECK(abandoned->Wait(5s));
+    CHECK(abandoned->Get() == 1);
+}
+
+TEST_CASE(RethrowsWhatTheCallThrew)
+{
+    const auto call = SupervisedCall<int>::Start([]() -> int { throw runtime_error("backend failed"); });
+    CHECK(call->Wait(5s));
+    CHECK_THROWS(call->Get());
+}
+
+TEST_CASE(ManyDelayedCallsAllComplete)
+{
+    const shared_ptr<FakeBackend> backend = make_shared<FakeBackend>();
+    vector<shared_ptr<SupervisedCall<int>>> calls;
+    for (int i = 0; i < 32; i++)
+    {
+        calls.push_back(SupervisedCall<int>::Start([backend, i]()
+            {
+                this_thread::sleep_for(chrono::milliseconds(i % 5));
+                return backend->Enumerate();
+            }));
+    }
+    for (const auto& call : calls)
+    {
+        CHECK(call->Wait(5s));
+        CHECK(call->Get() > 0);
+    }
+    CHECK(backend->Calls == 32);
+}
+
+TEST_MAIN()
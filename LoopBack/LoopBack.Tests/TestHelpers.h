@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A dependency free test runner, so the tests build anywhere a C++20 compiler does.
+// Every test file is its own executable: tests register with TEST_CASE and a failed
+// CHECK marks the running test as failed without stopping it.
+namespace LoopBackTests
+{
+    struct TestCase
+    {
+        const char* Name;
+        std::function<void()> Body;
+    };
+
+    inline std::vector<TestCase>& GetTestCases()
+    {
+        static std::vector<TestCase> cases;
+        return cases;
+    }
+
+    inline int& GetFailureCount()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    struct TestRegistration
+    {
+        TestRegistration(const char* name, std::function<void()> body)
+        {
+            GetTestCases().push_back({ name, std::move(body) });
+        }
+    };
+
+    inline void ReportFailure(const char* file, const int line, const char* expression)
+    {
+        std::printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+        GetFailureCount()++;
+    }
+
+    inline int RunTests()
+    {
+        int failed = 0;
+        for (const TestCase& test : GetTestCases())
+        {
+            const int before = GetFailureCount();
+            std::printf("[ RUN  ] %s\n", test.Name);
+            try
+            {
+                test.Body();
+            }
+            catch (const std::exception& ex)
+            {
+                std::printf("  unexpected exception: %s\n", ex.what());
+                GetFailureCount()++;
+            }
+            catch (...)
+            {
+                std::printf("  unexpected exception\n");
+                GetFailureCount()++;
+            }
+            const bool isPassed = GetFailureCount() == before;
+            std::printf(isPassed ? "[  OK  ] %s\n" : "[ FAIL ] %s\n", test.Name);
+            if (!isPassed) { failed++; }
+        }
+        std::printf("%zu tests, %d failed\n", GetTestCases().size(), failed);
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+#define LOOPBACK_TEST_CONCAT_INNER(left, right) left##right
+#define LOOPBACK_TEST_CONCAT(left, right) LOOPBACK_TEST_CONCAT_INNER(left, right)
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const LoopBackTests::TestRegistration LOOPBACK_TEST_CONCAT(name, Registration)(#name, name); \
+    static void name()
+
+#define CHECK(expression) \
+    do { if (!(expression)) { LoopBackTests::ReportFailure(__FILE__, __LINE__, #expression); } } while (false)
+
+#define CHECK_THROWS(expression) \
+    do { bool isThrown = false; try { (void)(expression); } catch (...) { isThrown = true; } \
+        if (!isThrown) { LoopBackTests::ReportFailure(__FILE__, __LINE__, "throws " #expression); } } while (false)
+
+#define TEST_MAIN() \
+    int main() { return LoopBackTests::RunTests(); }
@@ -0,0 +1,162 @@
+#include "TimerWheel.h"
+#include "TestHelpers.h"
+#include <map>
+#include <random>
+
+using namespace std;
+using namespace winrt::LoopBack::Metadata::implementation;
+
+namespace
+{
+    // A virtual clock over the wheel: the test moves time forward explicitly and collects
+    // what fired with the tick it fired at.
+    struct VirtualClock
+    {
+        TimerWheel Wheel;
+        uint64_t Now;
+        vector<pair<wstring, uint64_t>> Fired;
+
+        explicit VirtualClock(const uint64_t now = 0) : Wheel(now), Now(now) {}
+
+        void AdvanceTo(const uint64_t now)
+        {
+            Now = now;
+            for (wstring& key : Wheel.Advance(now))
+            {
+                Fired.emplace_back(move(key), now);
+            }
+        }
+
+        void Step(const uint64_t count)
+        {
+            for (uint64_t i = 0; i < count; i++)
+            {
+                AdvanceTo(Now + 1);
+            }
+        }
+    };
+}
+
+TEST_CASE(FiresAtTheDeadlineTick)
+{
+    VirtualClock clock(1000);
+    clock.Wheel.Schedule(L"S-1-15-2-1", 1003);
+    clock.Step(2);
+    CHECK(clock.Fired.empty());
+    clock.Step(1);
+    CHECK(clock.Fired.size() == 1);
+    CHECK(clock.Fired[0].first == L"S-1-15-2-1");
+    CHECK(clock.Fired[0].second == 1003);
+    CHECK(clock.Wheel.Size() == 0);
+}
+
+TEST_CASE(PastDeadlineFiresOnNextTick)
+{
+    VirtualClock clock(50);
+    clock.Wheel.Schedule(L"late", 10);
+    CHECK(clock.Wheel.Deadlines().at(L"late") == 51);
+    clock.Step(1);
+    CHECK(clock.Fired.size() == 1);
+}
+
+TEST_CASE(RescheduleAndCancelReplaceEarlierEntries)
+{
+    VirtualClock clock;
+    clock.Wheel.Schedule(L"moved", 5);
+    clock.Wheel.Schedule(L"moved", 20);
+    clock.Wheel.Schedule(L"cancelled", 7);
+    CHECK(clock.Wheel.Cancel(L"cancelled"));
+    CHECK(!clock.Wheel.Cancel(L"cancelled"));
+
+    clock.Step(10);
+    CHECK(clock.Fired.empty());
+    clock.Step(10);
+    CHECK(clock.Fired.size() == 1);
+    CHECK(clock.Fired[0].second == 20);
+}
+
+TEST_CASE(EntriesCascadeDownFromHigherLevels)
+{
+    //Deadlines on every level and past the last one, walked one tick at a time.
+    VirtualClock clock(7);
+    const vector<uint64_t> delays = { 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 16777216, 16777300 };
+    for (const uint64_t delay : delays)
+    {
+        clock.Wheel.Schedule(to_wstring(delay), 7 + delay);
+    }
+
+    clock.Step(16777300);
+    CHECK(clock.Fired.size() == delays.size());
+    for (size_t i = 0; i < clock.Fired.size() && i < delays.size(); i++)
+    {
+        CHECK(clock.Fired[i].first == to_wstring(delays[i]));
+        CHECK(clock.Fired[i].second == 7 + delays[i]);
+    }
+}
+
+TEST_CASE(LongGapFiresEverythingDueInDeadlineOrder)
+{
+    VirtualClock clock;
+    clock.Wheel.Schedule(L"third", 300);
+    clock.Wheel.Schedule(L"first", 100);
+    clock.Wheel.Schedule(L"second", 200);
+    clock.Wheel.Schedule(L"later", 100000);
+
+    clock.AdvanceTo(5000);
+    CHECK(clock.Fired.size() == 3);
+    CHECK(clock.Fired[0].first == L"first");
+    CHECK(clock.Fired[1].first == L"second");
+    CHECK(clock.Fired[2].first == L"third");
+    CHECK(clock.Wheel.Size() == 1);
+
+    clock.Step(94999);
+    CHECK(clock.Fired.size() == 3);
+    clock.Step(1);
+    CHECK(clock.Fired.size() == 4);
+    CHECK(clock.Fired[3].second == 100000);
+}
+
+TEST_CASE(RandomScheduleMatchesReference)
+{
+    //Mixed single steps and jumps against an ordered map of the same schedule.
+    mt19937_64 random(42);
+    VirtualClock clock(123456);
+    map<wstring, uint64_t> expected;
+    for (int i = 0; i < 2000; i++)
+    {
+        const wstring key = L"S-1-15-2-" + to_wstring(i % 700);
+        const uint64_t deadline = clock.Now + 1 + random() % 20000;
+        clock.Wheel.Schedule(key, deadline);
+        expected[key] = deadline;
+        if (i % 7 == 0)
+        {
+            clock.Wheel.Cancel(key);
+            expected.erase(key);
+        }
+        if (i % 50 == 0)
+        {
+            const uint64_t target = clock.Now + random() % 200;
+            clock.AdvanceTo(target);
+        }
+        else
+        {
+            clock.Step(1);
+        }
+
+        for (auto item = expected.begin(); item != expected.end();)
+        {
+            item = item->second <= clock.Now ? expected.erase(item) : next(item);
+        }
+        CHECK(clock.Wheel.Size() == expected.size());
+    }
+
+    clock.AdvanceTo(clock.Now + 30000);
+    CHECK(clock.Wheel.Size() == 0);
+    for (const auto& [key, tick] : clock.Fired)
+    {
+        (void)key;
+        CHECK(tick <= clock.Now);
+    }
+}
+
+TEST_MAIN()
@@ -10,13 +10,13 @@ namespace LoopBack.Common
 {
     internal sealed class TaskbarProgress
     {
-        private readonly ITaskbarList3 _taskbarList;
+        private readonly TaskbarProgressSink _sink;
         private readonly HWND hwnd = CoreWindow.GetForCurrentThread().As<ICoreWindowInterop>().WindowHandle;
 
         public TaskbarProgress(TaskbarList taskbarList)
         {
-            _taskbarList = taskbarList.As<ITaskbarList3>();
-            _taskbarList.HrInit();
+            taskbarList.As<ITaskbarList3>().HrInit();
+            _sink = new TaskbarProgressSink(taskbarList, (ulong)(nint)hwnd);
         }
 
         public static async Task<TaskbarProgress> GetForDispatcher(CoreDispatcher dispatcher)
@@ -35,14 +35,21 @@ namespace LoopBack.Common
         /// Allows to change the status of the progress bar in the task bar.
         /// </summary>
         /// <param name="state">State of the progress indicator.</param>
-        public void SetProgressState(TBPFLAG state) => _taskbarList.SetProgressState(hwnd, state);
+        public void SetProgressState(TBPFLAG state) => _sink.SetProgressState((TaskbarProgressState)state);
 
         /// <summary>
         /// Allows to change the fill of the task bar.
         /// </summary>
         /// <param name="current">Current value to display</param>
         /// <param name="max">Maximum number for division.</param>
-        public void SetProgressValue(ulong current, ulong max) => _taskbarList.SetProgressValue(hwnd, current, max);
+        /// <remarks>Values that do not change the visible percentage are dropped, and updates are sent at a limited rate;
+        /// a value held back goes out once the interval is over. Call <see cref="Flush"/> at the end of an operation to send it at once.</remarks>
+        public void SetProgressValue(ulong current, ulong max) => _sink.SetProgressValue(current, max);
+
+        /// <summary>
+        /// Sends the latest progress value held back by the rate limit.
+        /// </summary>
+        public void Flush() => _sink.Flush();
     }
 }
 
@@ -4,6 +4,7 @@ using LoopBack.Helpers;
 using LoopBack.Metadata;
 using Microsoft.Extensions.Logging;
 using System;
+using System.Collections.Generic;
 using System.Collections.ObjectModel;
 using System.ComponentModel;
 using System.Diagnostics.CodeAnalysis;
@@ -20,8 +21,17 @@ namespace LoopBack.ViewModels
     {
         private static readonly ResourceLoader _loader = ResourceLoader.GetForViewIndependentUse("ManagePage");
 
+        // A multiple of the 64 SIDs the server commits at once, so a batch is still one bulk job.
+        private const int SaveBatchSize = 256;
+
         private LoopUtil loopUtil;
+        private SnapshotReader snapshotReader;
+        private ulong loadedVersion;
+        // SIDs exempt as of the last load or save, which the toggles are saved against.
+        private readonly HashSet<string> savedExemptions = [];
+        private bool isSaving;
         private TaskbarProgress taskbar;
+        private string filter;
 
         private bool IsLoading
         {
@@ -92,12 +102,14 @@ namespace LoopBack.ViewModels
 
         public async Task Refresh()
         {
+            bool isChangedMeanwhile = false;
             try
             {
                 if (IsLoading) { return; }
                 IsLoading = true;
                 ShowLocalizedMessage("Loading");
                 await ThreadSwitcher.ResumeBackgroundAsync();
+                bool isShared = false;
                 if (loopUtil == null)
                 {
                     if (IsFullTrust || LoopBackProjectionFactory.ServerManager is not ServerManager serverManager)
@@ -112,13 +124,37 @@ namespace LoopBack.ViewModels
                         taskbar.SetProgressState(TBPFLAG.TBPF_INDETERMINATE);
                         loopUtil = serverManager.GetLoopUtil();
                         IsRunAsAdministrator = serverManager.IsRunAsAdministrator;
+                        isShared = true;
                     }
                 }
                 if (loopUtil != null)
                 {
-                    AppContainers = new(loopUtil.GetAppContainers());
-                    await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
-                    await FilteredAppContainers.AddRangeAsync(AppContainers, Dispatcher);
+                    ulong version = snapshotReader?.Version ?? 0;
+                    if (AppContainers == null)
+                    {
+                        AppContainers = new(loopUtil.GetAppContainers());
+                        ResetSavedExemptions();
+                        await ShowAppContainersAsync(AppContainers);
+                    }
+                    else
+                    {
+                        IReadOnlyList<AppContainerChange> changes = loopUtil.GetAppContainerChanges();
+                        AppContainers = new(loopUtil.Apps);
+                        if (changes.Count > 0)
+                        {
+                            await Dispatcher.AwaitableRunAsync(() => ApplyChanges(changes));
+                            RaisePropertyChangedEvent(nameof(IsExemptAll));
+                        }
+                    }
+                    if (isShared)
+                    {
+                        // Shared after the first load, so the server has a snapshot to share already.
+                        OpenSnapshotReader();
+                    }
+                    else
+                    {
+                        isChangedMeanwhile = !MarkSeenVersions(version, 1);
+                    }
                     ShowLocalizedMessage("Loaded");
                 }
                 else
@@ -130,6 +166,7 @@ namespace LoopBack.ViewModels
             {
                 taskbar = null;
                 loopUtil = null;
+                CloseSnapshotReader();
                 AppContainers = null;
                 FilteredAppContainers = null;
                 IsDirty = IsRunAsAdministrator = false;
@@ -145,6 +182,11 @@ namespace LoopBack.ViewModels
             {
                 IsLoading = false;
             }
+
+            if (isChangedMeanwhile)
+            {
+                await Refresh();
+            }
         }
 
         public async Task FilterDataAsync(string filter)
@@ -154,6 +196,7 @@ namespace LoopBack.ViewModels
                 try
                 {
                     await ThreadSwitcher.ResumeBackgroundAsync();
+                    this.filter = filter;
                     if (string.IsNullOrWhiteSpace(filter))
                     {
                         await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
@@ -163,20 +206,12 @@ namespace LoopBack.ViewModels
                     else
                     {
                         ShowLocalizedMessage("Filtering");
-                        string appsInFilter = filter;
                         await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
                         foreach (AppContainer app in AppContainers)
                         {
-                            if (app != null)
+                            if (app != null && IsMatchFilter(app))
                             {
-                                string appName = app.DisplayName;
-                                string packageFullName = app.PackageFullName;
-
-                                if (appName.Contains(appsInFilter, StringComparison.OrdinalIgnoreCase)
-                                    || packageFullName.Contains(appsInFilter, StringComparison.OrdinalIgnoreCase))
-                                {
-                                    await Dispatcher.AwaitableRunAsync(() => FilteredAppContainers.Add(app));
-                                }
+                                await Dispatcher.AwaitableRunAsync(() => FilteredAppContainers.Add(app));
                             }
                         }
                         ShowLocalizedMessage("Filtered");
@@ -201,47 +236,24 @@ namespace LoopBack.ViewModels
                 ShowLocalizedMessage("Sorting");
                 await ThreadSwitcher.ResumeBackgroundAsync();
                 CachedSortedColumn = sortBy;
-                AppContainer[] temp = [.. FilteredAppContainers];
-                await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
-                switch (sortBy)
+                AppContainerSortColumn? column = sortBy switch
                 {
-                    case "IsEnableLoop":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.IsEnableLoop)
-                            : temp.OrderByDescending(item => item.IsEnableLoop), Dispatcher);
-                        break;
-                    case "DisplayName":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.DisplayName)
-                            : temp.OrderByDescending(item => item.DisplayName), Dispatcher);
-                        break;
-                    case "AppContainerName":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.AppContainerName)
-                            : temp.OrderByDescending(item => item.AppContainerName), Dispatcher);
-                        break;
-                    case "WorkingDirectory":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.WorkingDirectory)
-                            : temp.OrderByDescending(item => item.WorkingDirectory), Dispatcher);
-                        break;
-                    case "PackageFullName":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.PackageFullName)
-                            : temp.OrderByDescending(item => item.PackageFullName), Dispatcher);
-                        break;
-                    case "Range":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.AppContainerSid)
-                            : temp.OrderByDescending(item => item.AppContainerSid), Dispatcher);
-                        break;
-                    case "UserSid":
-                        await FilteredAppContainers.AddRangeAsync(ascending
-                            ? temp.OrderBy(item => item.UserSid)
-                            : temp.OrderByDescending(item => item.UserSid), Dispatcher);
-                        break;
-                    default:
-                        break;
+                    "IsEnableLoop" => AppContainerSortColumn.IsEnableLoop,
+                    "DisplayName" => AppContainerSortColumn.DisplayName,
+                    "AppContainerName" => AppContainerSortColumn.AppContainerName,
+                    "WorkingDirectory" => AppContainerSortColumn.WorkingDirectory,
+                    "PackageFullName" => AppContainerSortColumn.PackageFullName,
+                    "Range" => AppContainerSortColumn.AppContainerSid,
+                    "UserSid" => AppContainerSortColumn.UserSid,
+                    _ => null
+                };
+                if (column is AppContainerSortColumn sortColumn)
+                {
+                    // The snapshot keeps a sorted order per column, so only the filtered walk crosses the proxy.
+                    string search = string.IsNullOrWhiteSpace(filter) ? string.Empty : filter.Trim();
+                    IReadOnlyList<AppContainer> sorted = loopUtil.GetSortedAppContainers(sortColumn, ascending, search);
+                    await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
+                    await FilteredAppContainers.AddRangeAsync(sorted, Dispatcher);
                 }
                 ShowLocalizedMessage("Sorted");
             }
@@ -286,8 +298,47 @@ namespace LoopBack.ViewModels
                 }
 
                 IsDirty = false;
-                AppContainer[] enableList = [.. AppContainers.Where(x => x.IsEnableLoop)];
-                if (loopUtil.SetLoopbackList(enableList) is Exception exception)
+                // Only the toggled rows are sent, so exemptions other clients made meanwhile are kept.
+                List<string> addList = [];
+                List<string> removeList = [];
+                foreach (AppContainer app in AppContainers)
+                {
+                    if (app == null) { continue; }
+                    string sid = app.AppContainerSid;
+                    bool isSaved = savedExemptions.Contains(sid);
+                    if (app.IsEnableLoop && !isSaved)
+                    {
+                        addList.Add(sid);
+                    }
+                    else if (!app.IsEnableLoop && isSaved)
+                    {
+                        removeList.Add(sid);
+                    }
+                }
+                ulong version = snapshotReader?.Version ?? 0;
+                ulong total = (ulong)(addList.Count + removeList.Count);
+                ulong committed = 0;
+                Exception exception = null;
+                try
+                {
+                    isSaving = true;
+                    if (total > 0)
+                    {
+                        taskbar?.SetProgressState(TBPFLAG.TBPF_NORMAL);
+                    }
+                    exception = CommitInBatches(addList, true, total, ref committed)
+                        ?? CommitInBatches(removeList, false, total, ref committed);
+                }
+                finally
+                {
+                    isSaving = false;
+                    if (total > 0)
+                    {
+                        taskbar?.Flush();
+                        taskbar?.SetProgressState(TBPFLAG.TBPF_NOPROGRESS);
+                    }
+                }
+                if (exception != null)
                 {
                     SettingsHelper.LoggerFactory.CreateLogger<ManageViewModel>().LogError(exception, "Failed to saving data. {message} (0x{hResult:X})", exception.GetMessage(), exception.HResult);
                     ShowLocalizedMessage("ErrorSavingFormat", exception.Message);
@@ -296,6 +347,10 @@ namespace LoopBack.ViewModels
                 {
                     ShowLocalizedMessage("SavedLoopbackExemptions");
                 }
+                if (!MarkSeenVersions(version, GetPublishCount(addList.Count) + GetPublishCount(removeList.Count)))
+                {
+                    await Refresh();
+                }
             }
             catch (Exception ex)
             {
@@ -323,8 +378,9 @@ namespace LoopBack.ViewModels
                         taskbar = await TaskbarProgress.GetForDispatcher(serverManager.GetTaskbarList(), Dispatcher);
                         IsRunAsAdministrator = serverManager.IsRunAsAdministrator;
                         AppContainers = new(loopUtil.GetAppContainers());
-                        await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
-                        await FilteredAppContainers.AddRangeAsync(AppContainers, Dispatcher);
+                        ResetSavedExemptions();
+                        OpenSnapshotReader();
+                        await ShowAppContainersAsync(AppContainers);
                         ShowLocalizedMessage(IsRunAsAdministrator ? "RunAsAdministratorNow" : "FailedRunAsAdministrator");
                         return;
                     }
@@ -342,6 +398,194 @@ namespace LoopBack.ViewModels
             }
         }
 
+        /// <summary>
+        /// Maps the snapshot section of the server, so that changes published by other clients,
+        /// expired exemptions and exemption rules are shown without a manual refresh.
+        /// The section only signals changes; the list is still loaded through <see cref="LoopUtil"/>.
+        /// </summary>
+        private void OpenSnapshotReader()
+        {
+            CloseSnapshotReader();
+            try
+            {
+                snapshotReader = new SnapshotReader(loopUtil.ShareSnapshotSection());
+                loadedVersion = snapshotReader.Version;
+                snapshotReader.VersionChanged += OnSnapshotVersionChanged;
+            }
+            catch (Exception ex)
+            {
+                snapshotReader = null;
+                SettingsHelper.LoggerFactory.CreateLogger<ManageViewModel>().LogWarning(ex, "Failed to map the snapshot section. {message} (0x{hResult:X})", ex.GetMessage(), ex.HResult);
+            }
+        }
+
+        private void CloseSnapshotReader()
+        {
+            if (snapshotReader != null)
+            {
+                snapshotReader.VersionChanged -= OnSnapshotVersionChanged;
+                snapshotReader.Dispose();
+                snapshotReader = null;
+            }
+        }
+
+        private async void OnSnapshotVersionChanged(SnapshotReader sender, ulong version)
+        {
+            // Versions published during our own refresh or save are checked once it is done.
+            if (IsLoading || isSaving || version == loadedVersion || AppContainers == null) { return; }
+            await Refresh();
+        }
+
+        /// <summary>
+        /// Takes the versions published since <paramref name="version"/> as seen, unless there are
+        /// more of them than the calls of this client could have published.
+        /// </summary>
+        /// <param name="version">The version before the calls.</param>
+        /// <param name="publishes">How many versions the calls publish at most.</param>
+        /// <returns><see langword="false"/> if another client published a version meanwhile.</returns>
+        private bool MarkSeenVersions(ulong version, int publishes)
+        {
+            if (snapshotReader == null) { return true; }
+            ulong current = snapshotReader.Version;
+            // Every publish moves the version on by two.
+            if (current - version > (ulong)publishes * 2) { return false; }
+            loadedVersion = current;
+            return true;
+        }
+
+        /// <summary>
+        /// Clears <see cref="FilteredAppContainers"/> and adds <paramref name="apps"/> to it,
+        /// showing in the taskbar how many rows are in.
+        /// </summary>
+        /// <param name="apps">The containers to show.</param>
+        private async Task ShowAppContainersAsync(IReadOnlyList<AppContainer> apps)
+        {
+            await Dispatcher.AwaitableRunAsync(FilteredAppContainers.Clear);
+            ulong total = (ulong)apps.Count;
+            ulong added = 0;
+            taskbar?.SetProgressState(TBPFLAG.TBPF_NORMAL);
+            foreach (AppContainer app in apps)
+            {
+                await Dispatcher.AwaitableRunAsync(() => FilteredAppContainers.Add(app));
+                taskbar?.SetProgressValue(++added, total);
+            }
+            taskbar?.Flush();
+            taskbar?.SetProgressState(TBPFLAG.TBPF_NOPROGRESS);
+        }
+
+        /// <summary>
+        /// Adds or removes the exemptions of <paramref name="list"/> in batches of <see cref="SaveBatchSize"/>,
+        /// showing in the taskbar how many of the <paramref name="total"/> SIDs of the save went out.
+        /// </summary>
+        /// <param name="list">The SIDs to add or remove.</param>
+        /// <param name="isAdd">Whether the SIDs are added.</param>
+        /// <param name="total">How many SIDs the whole save commits.</param>
+        /// <param name="committed">How many SIDs of the save went out so far.</param>
+        /// <returns>The error of the first batch that failed, or <see langword="null"/>.</returns>
+        private Exception CommitInBatches(List<string> list, bool isAdd, ulong total, ref ulong committed)
+        {
+            foreach (string[] batch in list.Chunk(SaveBatchSize))
+            {
+                Exception exception = isAdd ? loopUtil.AddLookbacksFromArray(batch) : loopUtil.RemoveLookbacksFromArray(batch);
+                if (exception != null) { return exception; }
+                if (isAdd)
+                {
+                    savedExemptions.UnionWith(batch);
+                }
+                else
+                {
+                    savedExemptions.ExceptWith(batch);
+                }
+                committed += (ulong)batch.Length;
+                taskbar?.SetProgressValue(committed, total);
+            }
+            return null;
+        }
+
+        /// <summary>
+        /// Gets how many versions a change of <paramref name="count"/> SIDs publishes at most,
+        /// since the server commits changes of more than 64 SIDs in chunks of 64.
+        /// </summary>
+        private static int GetPublishCount(int count) => (count + 63) / 64;
+
+        private void ResetSavedExemptions()
+        {
+            savedExemptions.Clear();
+            foreach (AppContainer app in AppContainers)
+            {
+                if (app?.IsEnableLoop == true)
+                {
+                    _ = savedExemptions.Add(app.AppContainerSid);
+                }
+            }
+        }
+
+        private bool IsMatchFilter(AppContainer app)
+        {
+            if (string.IsNullOrWhiteSpace(filter)) { return true; }
+            string appName = app.DisplayName;
+            string packageFullName = app.PackageFullName;
+            return appName.Contains(filter, StringComparison.OrdinalIgnoreCase)
+                || packageFullName.Contains(filter, StringComparison.OrdinalIgnoreCase);
+        }
+
+        /// <summary>
+        /// Applies the edit script from <see cref="LoopUtil.GetAppContainerChanges"/> to <see cref="FilteredAppContainers"/>,
+        /// so rows that did not change are left alone, and to the exemptions the toggles are saved against.
+        /// </summary>
+        /// <param name="changes">The changes since the last enumeration.</param>
+        private void ApplyChanges(IReadOnlyList<AppContainerChange> changes)
+        {
+            foreach (AppContainerChange change in changes)
+            {
+                switch (change.Kind)
+                {
+                    case AppContainerChangeKind.Added:
+                        if (change.NewValue.IsEnableLoop)
+                        {
+                            _ = savedExemptions.Add(change.NewValue.AppContainerSid);
+                        }
+                        if (IsMatchFilter(change.NewValue))
+                        {
+                            FilteredAppContainers.Add(change.NewValue);
+                        }
+                        break;
+                    case AppContainerChangeKind.Removed:
+                        _ = savedExemptions.Remove(change.OldValue.AppContainerSid);
+                        _ = FilteredAppContainers.Remove(change.OldValue);
+                        break;
+                    case AppContainerChangeKind.Changed:
+                        if (change.NewValue.IsEnableLoop)
+                        {
+                            _ = savedExemptions.Add(change.NewValue.AppContainerSid);
+                        }
+                        else
+                        {
+                            _ = savedExemptions.Remove(change.NewValue.AppContainerSid);
+                        }
+                        int index = FilteredAppContainers.IndexOf(change.OldValue);
+                        if (index >= 0)
+                        {
+                            if (IsMatchFilter(change.NewValue))
+                            {
+                                FilteredAppContainers[index] = change.NewValue;
+                            }
+                            else
+                            {
+                                FilteredAppContainers.RemoveAt(index);
+                            }
+                        }
+                        else if (IsMatchFilter(change.NewValue))
+                        {
+                            FilteredAppContainers.Add(change.NewValue);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
         public void ShowMessage(string log) => Message = $"{DateTime.Now:hh:mm:ss.fff} {log}";
 
         public void ShowLocalizedMessage(string resourceKey) => ShowMessage(_loader.GetString(resourceKey));